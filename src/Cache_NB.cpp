@@ -0,0 +1,203 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <thread>
+#include "Cache_NB.h"
+#include "File_NB.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <direct.h>
+#include <sys/stat.h>
+#include <sys/utime.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#include <utime.h>
+#endif
+
+static const char cache_ext[] = ".nbr";
+
+/// @brief Файл кэша при удалении лишних файлов.
+struct CacheEntry
+{
+    /// @brief Путь к файлу.
+    std::string path;
+    /// @brief Размер файла в байтах.
+    uint64_t size;
+    /// @brief Время последнего использования.
+    int64_t time;
+};
+
+/// @brief Размер файла.
+/// @param[in] p Путь к файлу.
+/// @return Размер в байтах или 0, если файла нет.
+static uint64_t file_size(const std::string& p)
+{
+#ifdef _WIN32
+    struct _stat64 st;
+
+    return _stat64(p.c_str(), &st) == 0 ? uint64_t(st.st_size) : 0;
+#else
+    struct stat st;
+
+    return stat(p.c_str(), &st) == 0 ? uint64_t(st.st_size) : 0;
+#endif
+}
+
+uint64_t fnv1a(const void* data, size_t size, uint64_t h)
+{
+    const unsigned char* p = (const unsigned char*)data;
+
+    for (size_t i = 0; i < size; ++i)
+    {
+        h ^= p[i];
+        h *= 0x100000001B3ULL;
+    }
+
+    return h;
+}
+
+uint64_t experiment_key(const ResultHeader& head, uint64_t storage)
+{
+    uint64_t h = fnv1a(&engine_version, sizeof(engine_version));
+
+    h = fnv1a(&head.d0_p, sizeof(head.d0_p), h);
+    h = fnv1a(&head.d0_k, sizeof(head.d0_k), h);
+    h = fnv1a(&head.d1_p, sizeof(head.d1_p), h);
+    h = fnv1a(&head.d1_k, sizeof(head.d1_k), h);
+    h = fnv1a(&head.n, sizeof(head.n), h);
+    h = fnv1a(&head.num_p_value, sizeof(head.num_p_value), h);
+    h = fnv1a(&head.seed, sizeof(head.seed), h);
+    h = fnv1a(&head.hyp, sizeof(head.hyp), h);
+    h = fnv1a(head.method, strnlen(head.method, sizeof(head.method)), h);
+
+    return fnv1a(&storage, sizeof(storage), h);
+}
+
+ResultCache::ResultCache(const char* _dir, uint64_t _max_bytes) : dir(_dir), max_bytes(_max_bytes)
+{
+    std::vector<CacheEntry> entries;
+
+#ifdef _WIN32
+    _mkdir(dir.c_str());
+#else
+    mkdir(dir.c_str(), 0755);
+#endif
+
+    total_bytes = scan(entries);
+}
+
+std::string ResultCache::path(uint64_t key) const
+{
+    char name[17];
+
+    sprintf(name, "%016llx", (unsigned long long)key);
+
+    return dir + "/" + name + cache_ext;
+}
+
+bool ResultCache::find(uint64_t key) const
+{
+    std::string p = path(key);
+
+    // Обновление времени изменения - отметка об использовании для вытеснения.
+#ifdef _WIN32
+    return _utime(p.c_str(), nullptr) == 0;
+#else
+    return utime(p.c_str(), nullptr) == 0;
+#endif
+}
+
+std::string ResultCache::temp_path(uint64_t key) const
+{
+    return path(key) + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+}
+
+void ResultCache::commit(uint64_t key, const std::string& tmp)
+{
+    std::string p = path(key);
+    uint64_t old_size = file_size(p), new_size = file_size(tmp);
+
+#ifdef _WIN32
+    remove(p.c_str());
+#endif
+    if (rename(tmp.c_str(), p.c_str()) != 0)
+    {
+        remove(tmp.c_str());
+        throw "ResultCache::commit: Unable to move result into the cache.";
+    }
+
+    std::lock_guard<std::mutex> lock(evict_mutex);
+
+    total_bytes = total_bytes + new_size > old_size ? total_bytes + new_size - old_size : 0;
+
+    if (total_bytes > max_bytes)
+        evict();
+}
+
+uint64_t ResultCache::scan(std::vector<CacheEntry>& entries) const
+{
+    uint64_t total = 0;
+
+#ifdef _WIN32
+    WIN32_FIND_DATAA fd;
+    HANDLE h = FindFirstFileA((dir + "/*" + cache_ext).c_str(), &fd);
+
+    if (h == INVALID_HANDLE_VALUE)
+        return 0;
+
+    do
+    {
+        uint64_t size = (uint64_t(fd.nFileSizeHigh) << 32) | fd.nFileSizeLow;
+        int64_t time = (int64_t(fd.ftLastWriteTime.dwHighDateTime) << 32) | fd.ftLastWriteTime.dwLowDateTime;
+
+        entries.push_back(CacheEntry{dir + "/" + fd.cFileName, size, time});
+    }
+    while (FindNextFileA(h, &fd));
+
+    FindClose(h);
+#else
+    DIR* d = opendir(dir.c_str());
+
+    if (!d)
+        return 0;
+
+    for (dirent* e = readdir(d); e; e = readdir(d))
+    {
+        size_t len = strlen(e->d_name), ext_len = sizeof(cache_ext) - 1;
+        struct stat st;
+        std::string p = dir + "/" + e->d_name;
+
+        if (len <= ext_len || strcmp(e->d_name + len - ext_len, cache_ext) != 0 || stat(p.c_str(), &st) != 0)
+            continue;
+
+        entries.push_back(CacheEntry{p, uint64_t(st.st_size), int64_t(st.st_mtime)});
+    }
+
+    closedir(d);
+#endif
+
+    for (size_t i = 0; i < entries.size(); ++i)
+        total += entries[i].size;
+
+    return total;
+}
+
+void ResultCache::evict()
+{
+    std::vector<CacheEntry> entries;
+    uint64_t total = scan(entries);
+
+    if (total > max_bytes)
+    {
+        std::sort(entries.begin(), entries.end(), [](const CacheEntry& a, const CacheEntry& b) { return a.time < b.time; });
+
+        for (size_t i = 0; i < entries.size() && total > max_bytes; ++i)
+            if (remove(entries[i].path.c_str()) == 0)
+                total -= entries[i].size;
+    }
+
+    total_bytes = total;
+}
@@ -0,0 +1,95 @@
+/// @file
+/// @brief Кэш результатов моделирования на диске.
+/// @details Результат эксперимента хранится в отдельном файле формата File_NB.h, имя которого - хэш параметров эксперимента
+/// (гипотезы, размер выборки, метод моделирования, размер выборки p-value, seed, вид хранения и версия алгоритмов моделирования).
+/// Поэтому повторный эксперимент с теми же параметрами, в том числе после перезапуска программы, читается из файла,
+/// а не моделируется заново. Суммарный размер файлов ограничен: при превышении удаляются давно не использованные файлы.
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct ResultHeader;
+struct CacheEntry;
+
+/// @brief Версия алгоритмов моделирования.
+/// @details Входит в ключ кэша. Увеличивается при любом изменении, после которого те же параметры и seed дают другую выборку p-value.
+const uint32_t engine_version = 2;
+
+/// @brief Размер кэша по умолчанию в байтах.
+const uint64_t default_cache_bytes = uint64_t(256) << 20;
+
+/// @brief Хэш FNV-1a (64 бита).
+/// @param[in] data Указатель на данные.
+/// @param[in] size Размер данных в байтах.
+/// @param[in] h Начальное значение (результат хэширования предыдущих данных).
+/// @return Хэш.
+uint64_t fnv1a(const void* data, size_t size, uint64_t h = 0xCBF29CE484222325ULL);
+
+/// @brief Ключ кэша эксперимента.
+/// @details Учитывает поля заголовка, от которых зависит выборка p-value (уровень значимости - нет), вид хранения и engine_version.
+/// @param[in] head Заголовок результата.
+/// @param[in] storage Вид хранения выборки p-value (0 - массив, иначе - количество интервалов эскиза).
+/// @return Ключ.
+uint64_t experiment_key(const ResultHeader& head, uint64_t storage);
+
+/// @brief Класс кэша результатов на диске.
+/// @details Файлы кэша лежат в одном каталоге. Время изменения файла обновляется при каждом обращении и служит
+/// меткой последнего использования. Запись выполняется во временный файл с последующим переименованием,
+/// поэтому кэшем могут одновременно пользоваться несколько потоков и процессов.
+class ResultCache
+{
+private:
+    /// @brief Каталог кэша.
+    std::string dir;
+    /// @brief Наибольший суммарный размер файлов кэша в байтах.
+    uint64_t max_bytes;
+    /// @brief Суммарный размер файлов кэша в байтах: вычисляется просмотром каталога при создании объекта и при удалении
+    /// файлов и увеличивается при каждой записи (файлы, записанные другими процессами, учитываются при следующем просмотре).
+    uint64_t total_bytes;
+    /// @brief Защищает total_bytes и удаление файлов от одновременного вызова из нескольких потоков.
+    std::mutex evict_mutex;
+
+    /// @brief Список файлов кэша.
+    /// @param[out] entries Файлы кэша.
+    /// @return Суммарный размер файлов в байтах.
+    uint64_t scan(std::vector<CacheEntry>& entries) const;
+
+    /// @brief Удаляет давно не использованные файлы, пока суммарный размер больше max_bytes (вызывается под evict_mutex).
+    void evict();
+public:
+    /// @brief Конструктор по каталогу и размеру кэша. Каталог создаётся, если его нет.
+    /// @param[in] _dir Каталог кэша.
+    /// @param[in] _max_bytes Наибольший суммарный размер файлов кэша в байтах.
+    ResultCache(const char* _dir, uint64_t _max_bytes = default_cache_bytes);
+
+    ResultCache(const ResultCache& c) = delete;
+    ResultCache& operator=(const ResultCache& c) = delete;
+
+    /// @brief Путь к файлу результата.
+    /// @param[in] key Ключ эксперимента.
+    /// @return Путь к файлу (файла может не быть).
+    std::string path(uint64_t key) const;
+
+    /// @brief Поиск результата в кэше.
+    /// @details Найденный файл отмечается как использованный.
+    /// @param[in] key Ключ эксперимента.
+    /// @return true, если файл результата есть.
+    bool find(uint64_t key) const;
+
+    /// @brief Путь к временному файлу для записи результата, свой для каждого потока.
+    /// @param[in] key Ключ эксперимента.
+    /// @return Путь к временному файлу.
+    std::string temp_path(uint64_t key) const;
+
+    /// @brief Помещает записанный во временный файл результат в кэш и, если суммарный размер стал больше max_bytes, удаляет лишние файлы.
+    /// @param[in] key Ключ эксперимента.
+    /// @param[in] tmp Путь к временному файлу, полученный temp_path.
+    void commit(uint64_t key, const std::string& tmp);
+
+    /// @brief Доступ к наибольшему размеру кэша.
+    /// @return Размер в байтах.
+    inline uint64_t get_max_bytes() const { return max_bytes; }
+};
@@ -1,11 +1,24 @@
 #include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
 #include <cstring>
+#include <sstream>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 #include "probdist.h"
+#include "File_NB.h"
+#include "Cache_NB.h"
 #include "Doc_NB.h"
 
 unsigned int seed = std::chrono::system_clock::now().time_since_epoch().count();
 std::default_random_engine generator;
-std::uniform_real_distribution<double> distribution(0.0, 1.0);
 
 double fast_deg(double x, size_t alpha)
 {
@@ -23,10 +36,94 @@ double fast_deg(double x, size_t alpha)
     return res;
 }
 
-NB_distr::NB_distr(double _p, size_t _k) : k(_k), p(_p), culc_n(0), prob_now(fast_deg(_p, _k))
+NB_distr::NB_distr(double _p, size_t _k) : k(_k), p(_p), culc_n(0), prob_now(0)
 {
     if (p >= 1 || p <= 0)
         p = 0.5;
+
+    make_support();
+    reset();
+}
+
+void NB_distr::make_support()
+{
+    double q = 1 - p, prob = fast_deg(p, k);
+    size_t m = mode();
+    bool from_mode = 1.0 + prob == 1.0;
+
+    lower_tail = upper_tail = 0;
+
+    if (k == 0)
+    {
+        lo = 0;
+        num_states = 1;
+        first_prob = 1;
+
+        return;
+    }
+
+    if (!from_mode)
+    {
+        // Вероятность нуля не пренебрежимо мала: окно начинается с нуля, и вероятности совпадают с прямым вычислением от нуля.
+        lo = 0;
+        first_prob = prob;
+    }
+    else
+    {
+        // Спуск от моды, пока вероятности не пренебрежимо малы. Значения дальше max_support / 2 от моды уходят в нижний хвост.
+        prob = exp(log_pmf(m));
+        lo = m;
+        first_prob = prob;
+
+        for (size_t x = m; x > 0; --x)
+        {
+            prob = prob * x / ((k + x - 1) * q);
+
+            if (1.0 + prob == 1.0)
+                break;
+
+            if (m - (x - 1) < max_support / 2)
+            {
+                lo = x - 1;
+                first_prob = prob;
+            }
+            else
+                lower_tail += prob;
+        }
+    }
+
+    // Подъём от lo до первого пренебрежимо малого значения за модой (та же формула, что в next_prob).
+    // Значения, не поместившиеся в max_support, уходят в верхний хвост.
+    double sum = first_prob;
+
+    prob = first_prob;
+    num_states = 1;
+
+    for (size_t x = lo + 1; ; ++x)
+    {
+        prob = prob * (k + x - 1) * q / x;
+
+        if (x > m && 1.0 + prob == 1.0)
+            break;
+
+        if (num_states < max_support)
+        {
+            ++num_states;
+            sum += prob;
+        }
+        else
+            upper_tail += prob;
+    }
+
+    // Вероятность моды через логарифм гамма-функции неточна в последних знаках, поэтому окно и хвосты нормируются.
+    if (from_mode)
+    {
+        double total = lower_tail + sum + upper_tail;
+
+        first_prob /= total;
+        lower_tail /= total;
+        upper_tail /= total;
+    }
 }
 
 double NB_distr::next_prob()
@@ -44,8 +141,18 @@ const char* NB_distr::name_of_distr() const
 
 void NB_distr::reset()
 {
-    prob_now = fast_deg(p, k);
-    culc_n = 0;
+    prob_now = first_prob;
+    culc_n = lo;
+}
+
+size_t NB_distr::mode() const
+{
+    return k > 1 ? size_t((k - 1) * (1 - p) / p) : 0;
+}
+
+double NB_distr::log_pmf(size_t x) const
+{
+    return lgamma(double(k) + x) - lgamma(double(k)) - lgamma(double(x) + 1) + k * log(p) + x * log1p(-p);
 }
 
 void Sample::swap(Sample& s)
@@ -58,46 +165,284 @@ void Sample::swap(Sample& s)
     d = s.d;
     s.d = buff_d;
 
-    size_t* buff_sam = sam;
+    unsigned char* buff_sam = sam;
     sam = s.sam;
     s.sam = buff_sam;
+
+    size_t buff_width = width;
+    width = s.width;
+    s.width = buff_width;
+
+    std::default_random_engine buff_own_gen = own_gen;
+    own_gen = s.own_gen;
+    s.own_gen = buff_own_gen;
+    // gen может указывать на собственный генератор объекта, поэтому такой указатель переводится на генератор, с которым обменялись.
+    std::default_random_engine* buff_gen = gen == &own_gen ? &s.own_gen : gen;
+    gen = s.gen == &s.own_gen ? &own_gen : s.gen;
+    s.gen = buff_gen;
+}
+
+/// Передаёт владение массивом неизменяемой разделяемой таблице.
+template <class T>
+std::shared_ptr<const T> share_array(T* arr)
+{
+    return std::shared_ptr<const T>(arr, std::default_delete<T[]>());
 }
 
-Sample::Sample(size_t _n, NB_distr* _d) : n(_n), d(_d)
+/// Ширина в байтах наименьшего беззнакового типа, в который помещается значение.
+size_t width_for(size_t value)
 {
-    sam = new size_t[n];
+    if (value <= UINT8_MAX)
+        return 1;
+
+    if (value <= UINT16_MAX)
+        return 2;
+
+    if (value <= UINT32_MAX)
+        return 4;
+
+    return 8;
+}
+
+/// Элемент i массива чисел ширины width.
+inline size_t load_value(const unsigned char* data, size_t width, size_t i)
+{
+    switch (width)
+    {
+    case 1:
+        return ((const uint8_t*)data)[i];
+    case 2:
+        return ((const uint16_t*)data)[i];
+    case 4:
+        return ((const uint32_t*)data)[i];
+    default:
+        return ((const uint64_t*)data)[i];
+    }
+}
+
+/// Записывает count значений в массив чисел типа T.
+template <class T>
+inline void store_values(const size_t* src, size_t count, T* dst)
+{
+    for (size_t i = 0; i < count; ++i)
+        dst[i] = T(src[i]);
 }
 
-Sample::Sample(const Sample& s) : n(s.n), d(s.d)
+/// Записывает значение в элементы [begin, end) массива чисел типа T.
+template <class T>
+inline void fill_values(T* dst, size_t begin, size_t end, size_t value)
 {
-    sam = new size_t[n];
+    std::fill(dst + begin, dst + end, T(value));
+}
+
+/// Упорядоченные равномерные числа \f$ U_{(1)} \leq \ldots \leq U_{(n)} \f$ в виде \f$ U_{(i)} = S_i / S_{n + 1} \f$,
+/// где \f$ S_i \f$ - суммы i независимых экспоненциальных интервалов. Записывает \f$ S_1, \ldots, S_n \f$ в sums и возвращает \f$ S_{n + 1} \f$.
+double exp_spacings(double* sums, size_t n, std::default_random_engine& rng)
+{
+    double total = 0;
 
+    // 1 - U принадлежит (0, 1], поэтому логарифм конечен.
     for (size_t i = 0; i < n; ++i)
-        sam[i] = s.sam[i];
+    {
+        total -= log(1 - uniform(rng));
+        sums[i] = total;
+    }
+
+    return total - log(1 - uniform(rng));
+}
+
+/// Один проход по упорядоченным числам sums[i] / total и таблице суммированных вероятностей: числа из (table[j - 1], table[j]]
+/// получают значение j, как при поиске первого j с table[j] >= alpha. Для каждого непустого значения вызывает on_run(j, begin, end)
+/// с номерами чисел [begin, end) и возвращает количество чисел, не превосходящих последнего значения таблицы.
+/// Пустые значения пропускаются двоичным поиском, поэтому широкие таблицы проходятся за O(n log num_table).
+template <class F>
+size_t sweep_sorted(const double* sums, size_t n, double total, const double* table, size_t num_table, F on_run)
+{
+    size_t i = 0, j = 0;
+
+    while (i < n)
+    {
+        j = std::lower_bound(table + j, table + num_table, sums[i], [total](double t, double x) { return t * total < x; }) - table;
+
+        if (j == num_table)
+            break;
+
+        double bound = table[j] * total;
+        size_t begin = i;
+
+        while (i < n && sums[i] <= bound)
+            ++i;
+
+        on_run(j, begin, i);
+        ++j;
+    }
+
+    return i;
+}
+
+Sample::Sample(size_t _n, NB_distr* _d) : n(_n), d(_d), sam(nullptr), width(1), gen(&generator)
+{
+
+}
+
+Sample::Sample(const Sample& s) : n(s.n), d(s.d), sam(nullptr), width(s.width), own_gen(*s.gen)
+{
+    gen = &own_gen;
 }
 
-Sample::Sample(Sample&& s)
+Sample::Sample(Sample&& s) : n(0), d(nullptr), sam(nullptr), width(1), gen(&generator)
 {
     this->swap(s);
 }
 
+void Sample::allocate()
+{
+    if (!sam)
+        sam = new unsigned char[n * width];
+}
+
+void Sample::reserve_width(size_t max_value, size_t filled)
+{
+    size_t new_width = width_for(max_value);
+
+    if (new_width <= width)
+        return;
+
+    if (!sam)
+    {
+        width = new_width;
+
+        return;
+    }
+
+    unsigned char* new_sam = new unsigned char[n * new_width];
+
+    for (size_t i = 0; i < filled; ++i)
+    {
+        size_t value = load_value(sam, width, i);
+
+        switch (new_width)
+        {
+        case 2:
+            ((uint16_t*)new_sam)[i] = uint16_t(value);
+            break;
+        case 4:
+            ((uint32_t*)new_sam)[i] = uint32_t(value);
+            break;
+        default:
+            ((uint64_t*)new_sam)[i] = value;
+        }
+    }
+
+    delete[] sam;
+    sam = new_sam;
+    width = new_width;
+}
+
 void Sample::simulate()
 {
-    for (size_t i = 0; i < n; ++i)
-        sam[i] = simulate_one();
+    // Выборка моделируется блоками, помещающимися в кэш L1, и сразу записывается в узком типе.
+    size_t chunk[bulk_buffer];
+
+    allocate();
+
+    for (size_t i = 0; i < n; i += bulk_buffer)
+    {
+        size_t num = std::min(bulk_buffer, n - i), max_value = 0;
+
+        simulate_bulk(chunk, num, *gen);
+
+        for (size_t t = 0; t < num; ++t)
+            max_value = std::max(max_value, chunk[t]);
+
+        reserve_width(max_value, i);
+
+        switch (width)
+        {
+        case 1:
+            store_values(chunk, num, (uint8_t*)sam + i);
+            break;
+        case 2:
+            store_values(chunk, num, (uint16_t*)sam + i);
+            break;
+        case 4:
+            store_values(chunk, num, (uint32_t*)sam + i);
+            break;
+        default:
+            store_values(chunk, num, (uint64_t*)sam + i);
+        }
+    }
+}
+
+void Sample::fill_value(size_t begin, size_t end, size_t value)
+{
+    switch (width)
+    {
+    case 1:
+        fill_values((uint8_t*)sam, begin, end, value);
+        break;
+    case 2:
+        fill_values((uint16_t*)sam, begin, end, value);
+        break;
+    case 4:
+        fill_values((uint32_t*)sam, begin, end, value);
+        break;
+    default:
+        fill_values((uint64_t*)sam, begin, end, value);
+    }
+}
+
+void Sample::simulate_freq(size_t* freq, size_t num, size_t first)
+{
+    simulate();
+    count_freq(freq, num, first);
+}
+
+void Sample::count_freq(size_t* freq, size_t num, size_t first) const
+{
+    if (!sam)
+        return;
+
+    switch (width)
+    {
+    case 1:
+        add_freq(view<uint8_t>(), freq, num, first);
+        break;
+    case 2:
+        add_freq(view<uint16_t>(), freq, num, first);
+        break;
+    case 4:
+        add_freq(view<uint32_t>(), freq, num, first);
+        break;
+    default:
+        add_freq(view<uint64_t>(), freq, num, first);
+    }
+}
+
+void Sample::set_generator(std::default_random_engine* _gen)
+{
+    gen = _gen;
+}
+
+void Sample::rebind(NB_distr* _d)
+{
+    d = _d;
 }
 
 void Sample::change_param(size_t _n)
 {
+    if (_n == n)
+        return;
+
     n = _n;
 
     delete[] sam;
-    sam = new size_t[n];
+    sam = nullptr;
 }
 
 size_t Sample::operator[] (int i) const
 {
-    return sam[i];
+    return sam ? load_value(sam, width, i) : 0;
 }
 
 Sample::~Sample()
@@ -105,18 +450,9 @@ Sample::~Sample()
     delete[] sam;
 }
 
-size_t Sample_Table::max_num(NB_distr* d) const
+size_t Sample_Table::max_num(NB_distr* d)
 {
-    size_t j = 0;
-    double v = fast_deg(d->get_p(), d->get_k());
-
-    while (v + 1.0 != 1.0)
-    {
-        ++j;
-        v = v * (d->get_k() + j) / j * (1 - d->get_p());
-    }
-
-    return j;
+    return d->get_num_states();
 }
 
 void Sample_Table::swap(Sample_Table& s)
@@ -127,42 +463,48 @@ void Sample_Table::swap(Sample_Table& s)
     num_sum_distr = s.num_sum_distr;
     s.num_sum_distr = buff_num_sum_distr;
 
-    double* buff_sum_distr = sum_distr;
-    sum_distr = s.sum_distr;
-    s.sum_distr = buff_sum_distr;
+    sum_distr.swap(s.sum_distr);
 }
 
 void Sample_Table::make_sum_distr()
 {
-    num_sum_distr = max_num(d);
+    // Таблица фиксированной гипотезы вычислена при компиляции и не освобождается.
+    if (const FixedView* f = find_fixed(d->get_p(), d->get_k()))
+    {
+        num_sum_distr = f->num;
+        sum_distr = std::shared_ptr<const double>(f->sum, [](const double*) {});
 
-    sum_distr = new double[num_sum_distr];
+        return;
+    }
 
-    d->reset();
-    sum_distr[0] = d->get_prob_now();
+    num_sum_distr = max_num(d);
+
+    double* table = new double[num_sum_distr];
 
+    // Значения нижнего хвоста получают первое значение окна.
     d->reset();
+    table[0] = d->get_lower_tail() + d->get_prob_now();
 
     for (size_t i = 1; i < num_sum_distr; ++i)
-        sum_distr[i] = sum_distr[i - 1] + d->next_prob();
+        table[i] = table[i - 1] + d->next_prob();
+
+    sum_distr = share_array(table);
 }
 
 Sample_Table::Sample_Table(size_t _n, NB_distr* _d) : Sample(_n, _d)
 {
     make_sum_distr();
+    reserve_width(d->get_lo() + num_sum_distr);
 }
 
-Sample_Table::Sample_Table(const Sample_Table& s) : Sample(s)
+Sample_Table::Sample_Table(const Sample_Table& s) : Sample(s), sum_distr(s.sum_distr), num_sum_distr(s.num_sum_distr)
 {
-    sum_distr = new double[s.num_sum_distr];
 
-    for (size_t i = 0; i < s.num_sum_distr; ++i)
-        sum_distr[i] = s.sum_distr[i];
 }
 
-Sample_Table::Sample_Table(Sample_Table&& s) : Sample(s)
+Sample_Table::Sample_Table(Sample_Table&& s) : Sample(std::move(s)), sum_distr(std::move(s.sum_distr)), num_sum_distr(s.num_sum_distr)
 {
-    this->swap(s);
+
 }
 
 Sample_Table& Sample_Table::operator=(Sample_Table s)
@@ -179,362 +521,2331 @@ const char* Sample_Table::get_name() const
 
 size_t Sample_Table::simulate_one()
 {
-    size_t j = 0;
+    return d->get_lo() + table_search(sum_distr.get(), num_sum_distr, uniform(*gen));
+}
 
-    double alpha = distribution(generator);
+void Sample_Table::simulate_bulk(size_t* out, size_t count, std::default_random_engine& rng)
+{
+    double buff[bulk_buffer];
+    const double* table = sum_distr.get();
 
-    while (sum_distr[j] < alpha && j < num_sum_distr)
-        ++j;
+    for (size_t i = 0; i < count; i += bulk_buffer)
+    {
+        size_t num = std::min(bulk_buffer, count - i);
 
-    return j;
+        for (size_t t = 0; t < num; ++t)
+            buff[t] = uniform(rng);
+
+        for (size_t t = 0; t < num; ++t)
+            out[i + t] = d->get_lo() + table_search(table, num_sum_distr, buff[t]);
+    }
 }
 
-void Sample_Table::change_param(size_t _n)
+void Sample_Table::simulate_freq(size_t* freq, size_t num, size_t first)
 {
-    Sample::change_param(_n);
+    double mean = d->get_k() * (1 - d->get_p()) / d->get_p();
 
-    delete[] sum_distr;
+    if (mean < sorted_min_mean)
+        return Sample::simulate_freq(freq, num, first);
 
-    make_sum_distr();
+    double* sums = new double[n];
+    double total = exp_spacings(sums, n, *gen);
+    size_t lo = d->get_lo();
+
+    allocate();
+
+    auto on_run = [&](size_t j, size_t begin, size_t end)
+    {
+        freq[freq_state(lo + j, first, num)] += end - begin;
+        fill_value(begin, end, lo + j);
+    };
+
+    size_t i = sweep_sorted(sums, n, total, sum_distr.get(), num_sum_distr, on_run);
+
+    // Числа, большие последнего значения таблицы, получают значение num_sum_distr, как в simulate_one.
+    if (i < n)
+        on_run(num_sum_distr, i, n);
+
+    delete[] sums;
 }
 
-Sample_Table::~Sample_Table()
+void Sample_Table::rebuild()
 {
-    delete[] sum_distr;
+    make_sum_distr();
+    reserve_width(d->get_lo() + num_sum_distr);
 }
 
-Sample_Bernulli::Sample_Bernulli(size_t _n, NB_distr* _d) : Sample(_n, _d)
+Sample* Sample_Table::clone() const
 {
-
+    return new Sample_Table(*this);
 }
 
-Sample_Bernulli::Sample_Bernulli(const Sample_Bernulli& s) : Sample(s)
+void Sample_Table_Tail::make_sum_distr()
 {
+    num_full = Sample_Table::max_num(d);
 
-}
+    // Таблица растёт до квантиля 1 - tail, но не дальше полной таблицы.
+    std::vector<double> table;
 
-Sample_Bernulli::Sample_Bernulli(Sample_Bernulli&& s) : Sample(s)
-{
-    
+    d->reset();
+    table.push_back(d->get_lower_tail() + d->get_prob_now());
+
+    while (table.size() < num_full && table.back() < 1 - tail)
+        table.push_back(table.back() + d->next_prob());
+
+    num_sum_distr = std::min(table.size(), num_full);
+    last_prob = d->get_prob_now();
+
+    double* arr = new double[num_sum_distr + 1];
+
+    std::copy(table.begin(), table.begin() + num_sum_distr, arr);
+    arr[num_sum_distr] = 2;
+    sum_distr = share_array(arr);
 }
 
-Sample_Bernulli& Sample_Bernulli::operator=(Sample_Bernulli s)
+Sample_Table_Tail::Sample_Table_Tail(size_t _n, NB_distr* _d, double _tail) : Sample(_n, _d), tail(_tail)
 {
-    this->swap(s);
-
-    return *this;
+    make_sum_distr();
+    reserve_width(d->get_lo() + num_full);
 }
 
-const char* Sample_Bernulli::get_name() const
+const char* Sample_Table_Tail::get_name() const
 {
-    return  "Bernulli Method";
+    return "Table Method";
 }
 
-size_t Sample_Bernulli::simulate_one()
+size_t Sample_Table_Tail::find_tail(double alpha) const
 {
-    size_t l = 0, j = 0;
+    // Те же операции, что NB_distr::next_prob и Sample_Table::make_sum_distr, чтобы суммы совпадали с полной таблицей.
+    double prob = last_prob, sum = sum_distr.get()[num_sum_distr - 1];
+    size_t j = num_sum_distr, lo = d->get_lo();
 
-    while (l != d->get_k())
-        distribution(generator) > d->get_p() ? ++j : ++l;
+    for (; j < num_full; ++j)
+    {
+        prob = prob * (d->get_k() + lo + j - 1) * (1 - d->get_p()) / (lo + j);
+        sum = sum + prob;
+
+        if (!(sum < alpha))
+            break;
+    }
 
     return j;
 }
 
-void ChiSqHist::swap(ChiSqHist& c)
+void Sample_Table_Tail::rebuild()
 {
-    NB_distr* buff_d = d;
-    d = c.d, c.d = buff_d;
-    Sample* buff_s = s;
-    s = c.s, c.s = buff_s;
-    size_t buff_df = df;
-    df = c.df, c.df = buff_df;
-    double buff_chi_sq_stat = chi_sq_stat, buff_p_value = p_value;
-    chi_sq_stat = c.chi_sq_stat, c.chi_sq_stat = buff_chi_sq_stat;
-    p_value = c.p_value, c.p_value = buff_p_value;
+    make_sum_distr();
+    reserve_width(d->get_lo() + num_full);
+}
 
-    size_t buff_num_freq = num_freq;
-    num_freq = c.num_freq;
-    size_t* buff_exp_freq = exp_freq;
-    exp_freq = c.exp_freq, c.exp_freq = buff_exp_freq;
-    double* buff_th_freq = th_freq;
-    th_freq = c.th_freq, c.th_freq = buff_th_freq;
+size_t Sample_Table_Tail::simulate_one()
+{
+    return d->get_lo() + find(sum_distr.get(), uniform(*gen));
 }
 
-ChiSqHist::ChiSqHist(NB_distr* _d, Sample* _s) : d(_d), s(_s)
+void Sample_Table_Tail::simulate_bulk(size_t* out, size_t count, std::default_random_engine& rng)
 {
-    exp_freq = new size_t[10];
-    th_freq = new double[10];
+    double buff[bulk_buffer];
+    const double* table = sum_distr.get();
 
-    if (_d && _s)
+    for (size_t i = 0; i < count; i += bulk_buffer)
     {
-        calc_th_freq();
-        calc_exp_freq();
+        size_t num = std::min(bulk_buffer, count - i);
+
+        for (size_t t = 0; t < num; ++t)
+            buff[t] = uniform(rng);
+
+        for (size_t t = 0; t < num; ++t)
+            out[i + t] = d->get_lo() + find(table, buff[t]);
     }
 }
 
-ChiSqHist::ChiSqHist(ChiSqHist& c) : d(c.d), s(c.s), df(c.df), chi_sq_stat(c.chi_sq_stat), p_value(c.p_value), num_freq(c.num_freq)
+void Sample_Table_Tail::simulate_freq(size_t* freq, size_t num, size_t first)
 {
-    exp_freq = new size_t[num_freq];
-    th_freq = new double[num_freq];
+    double mean = d->get_k() * (1 - d->get_p()) / d->get_p();
 
-    for (size_t i = 0; i < num_freq; ++i)
+    if (mean < sorted_min_mean)
+        return Sample::simulate_freq(freq, num, first);
+
+    double* sums = new double[n];
+    double total = exp_spacings(sums, n, *gen);
+    size_t lo = d->get_lo();
+
+    allocate();
+
+    auto on_run = [&](size_t j, size_t begin, size_t end)
     {
-        exp_freq[i] = c.exp_freq[i];
-        th_freq[i] = c.th_freq[i];
+        freq[freq_state(lo + j, first, num)] += end - begin;
+        fill_value(begin, end, lo + j);
+    };
+
+    size_t i = sweep_sorted(sums, n, total, sum_distr.get(), num_sum_distr, on_run);
+
+    for (; i < n; ++i)
+    {
+        size_t j = find(sum_distr.get(), sums[i] / total);
+
+        on_run(j, i, i + 1);
     }
+
+    delete[] sums;
 }
 
-ChiSqHist::ChiSqHist(ChiSqHist&& c)
+Sample* Sample_Table_Tail::clone() const
 {
-    this->swap(c);
+    return new Sample_Table_Tail(*this);
 }
 
-ChiSqHist& ChiSqHist::operator=(ChiSqHist c)
+constexpr uint64_t Sample_Table_Int::range;
+
+void Sample_Table_Int::make_thresholds()
 {
-    this->swap(c);
+    num_thresholds = std::max(Sample_Table::max_num(d), size_t(1));
 
-    return *this;
-}
+    uint64_t* table = new uint64_t[num_thresholds];
+    const long double scale = (long double)range * range;
+    double sum = d->get_lower_tail();
 
-void ChiSqHist::calc_th_freq()
-{
     d->reset();
-    num_freq = 0;
 
-    while (1.0 + d->next_prob() != 1.0)
-        ++num_freq;
+    for (size_t i = 0; i < num_thresholds; ++i)
+    {
+        sum += i ? d->next_prob() : d->get_prob_now();
 
-    delete[] th_freq;
+        long double t = sum * scale;
+        table[i] = t >= scale ? UINT64_MAX : uint64_t(t + 0.5L);
+    }
 
-    th_freq = new double[num_freq];
+    // Последний порог покрывает все числа, поэтому остаток вероятности не уходит за пределы таблицы.
+    table[num_thresholds - 1] = UINT64_MAX;
+    thresholds = share_array(table);
+}
 
-    d->reset();
-    th_freq[0] = d->get_prob_now();
+Sample_Table_Int::Sample_Table_Int(size_t _n, NB_distr* _d) : Sample(_n, _d)
+{
+    make_thresholds();
+    reserve_width(d->get_lo() + num_thresholds);
+}
 
-    for (size_t i = 1; i < num_freq; ++i)
-        th_freq[i] = d->next_prob();
+const char* Sample_Table_Int::get_name() const
+{
+    return "Integer Table Method";
 }
 
-void ChiSqHist::calc_exp_freq()
+void Sample_Table_Int::rebuild()
 {
-    size_t inx = 0;
+    make_thresholds();
+    reserve_width(d->get_lo() + num_thresholds);
+}
 
-    delete[] exp_freq;
+size_t Sample_Table_Int::simulate_one()
+{
+    return d->get_lo() + find(thresholds.get(), draw(*gen));
+}
 
-    exp_freq = new size_t[num_freq]{};
+void Sample_Table_Int::simulate_bulk(size_t* out, size_t count, std::default_random_engine& rng)
+{
+    const uint64_t* table = thresholds.get();
 
-    for (size_t i = 0; i < s->get_n(); ++i)
-    {   
-        inx = (*s)[i];
+    size_t lo = d->get_lo();
 
-        if (inx > num_freq)
-            ++exp_freq[num_freq - 1];
-        else
-            ++exp_freq[inx];
-    }
+    for (size_t i = 0; i < count; ++i)
+        out[i] = lo + find(table, draw(rng));
 }
 
-void ChiSqHist::set_data(NB_distr* _d, Sample* _s)
+Sample* Sample_Table_Int::clone() const
 {
-    d = _d;
-    s = _s;
-
-    calc_th_freq();
-    calc_exp_freq();
+    return new Sample_Table_Int(*this);
 }
 
-size_t ChiSqHist::merge(size_t* exp_freq_merge, double* th_freq_merge)
+/// Количество единичных битов.
+inline size_t popcount64(uint64_t x)
 {
-    size_t j = 0;
+#ifdef _MSC_VER
+    return __popcnt64(x);
+#else
+    return __builtin_popcountll(x);
+#endif
+}
+
+/// Номер младшего единичного бита (x != 0).
+inline size_t ctz64(uint64_t x)
+{
+#ifdef _MSC_VER
+    unsigned long inx;
+    _BitScanForward64(&inx, x);
+
+    return inx;
+#else
+    return __builtin_ctzll(x);
+#endif
+}
+
+/// Равномерное 64-битное слово из трёх значений генератора по 22 младших бита.
+/// Значения из неполного последнего блока по 2^22 отбрасываются, поэтому биты слова независимы и равновероятны.
+inline uint64_t random_word(std::default_random_engine& g)
+{
+    const uint64_t range = uint64_t(std::default_random_engine::max() - std::default_random_engine::min()) + 1;
+    const uint64_t limit = (range >> 22) << 22;
+    uint64_t word = 0;
+
+    for (int i = 0; i < 3; ++i)
+    {
+        uint64_t x;
+
+        do
+            x = uint64_t(g() - std::default_random_engine::min());
+        while (x >= limit);
+
+        word = (word << 22) | (x & ((uint64_t(1) << 22) - 1));
+    }
+
+    return word;
+}
+
+/// Вероятность в виде 64-разрядной двоичной дроби (p в (0, 1)).
+inline uint64_t fraction_bits(double p)
+{
+    return uint64_t(ldexp(p, 64));
+}
+
+Sample_Bernulli_Bits::Sample_Bernulli_Bits(size_t _n, NB_distr* _d) : Sample(_n, _d)
+{
+
+}
+
+const char* Sample_Bernulli_Bits::get_name() const
+{
+    return "Bit Bernulli Method";
+}
+
+uint64_t Sample_Bernulli_Bits::success_mask(std::default_random_engine& g, uint64_t p_bits)
+{
+    uint64_t undecided = ~uint64_t(0), success = 0;
+
+    for (int b = 63; b >= 0 && undecided; --b)
+    {
+        uint64_t u = random_word(g), p = (p_bits >> b) & 1 ? ~uint64_t(0) : 0;
+
+        // Разряд U равен 0, разряд p равен 1: U < p.
+        success |= undecided & ~u & p;
+        undecided &= ~(u ^ p);
+
+        // Оставшиеся разряды p нулевые: нерешённые испытания уже не могут оказаться меньше p.
+        if ((p_bits & ((uint64_t(1) << b) - 1)) == 0)
+            break;
+    }
+
+    return success;
+}
+
+size_t Sample_Bernulli_Bits::simulate_one()
+{
+    size_t res;
+
+    simulate_bulk(&res, 1, *gen);
+
+    return res;
+}
+
+void Sample_Bernulli_Bits::simulate_bulk(size_t* out, size_t count, std::default_random_engine& rng)
+{
+    const size_t k = d->get_k();
+    const uint64_t p_bits = fraction_bits(d->get_p());
+    // Неиспользованные испытания: младшие avail битов mask.
+    uint64_t mask = 0;
+    size_t avail = 0;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        size_t l = 0, j = 0;
+
+        while (l != k)
+        {
+            if (avail == 0)
+            {
+                mask = success_mask(rng, p_bits);
+                avail = 64;
+            }
+
+            size_t num = popcount64(mask);
+
+            if (l + num < k)
+            {
+                l += num;
+                j += avail - num;
+                avail = 0;
+
+                continue;
+            }
+
+            // (k - l)-й успех среди оставшихся испытаний завершает элемент.
+            uint64_t m = mask;
+
+            for (size_t r = l + 1; r < k; ++r)
+                m &= m - 1;
+
+            size_t pos = ctz64(m);
+
+            j += pos + 1 - (k - l);
+            l = k;
+            avail -= pos + 1;
+            mask = pos == 63 ? 0 : mask >> (pos + 1);
+        }
+
+        out[i] = j;
+    }
+}
+
+Sample* Sample_Bernulli_Bits::clone() const
+{
+    return new Sample_Bernulli_Bits(*this);
+}
+
+/// Перебирает специализации Sample_Table_Fixed от I до num_fixed_configs - 1; если гипотезы i нет в списке - nullptr.
+template <size_t I>
+Sample* make_table_fixed(size_t i, size_t n, NB_distr* d)
+{
+    return i == I ? new Sample_Table_Fixed<I>(n, d) : make_table_fixed<I + 1>(i, n, d);
+}
+
+template <>
+Sample* make_table_fixed<num_fixed_configs>(size_t, size_t, NB_distr*)
+{
+    return nullptr;
+}
+
+Sample* make_sample_table(size_t n, NB_distr* d)
+{
+    if (Sample* s = make_table_fixed<0>(fixed_index(d->get_p(), d->get_k()), n, d))
+        return s;
+
+    size_t num = Sample_Table::max_num(d);
+
+    if (num < 64)
+        return new Sample_Table_N<64>(n, d);
+
+    if (num < 256)
+        return new Sample_Table_N<256>(n, d);
+
+    return new Sample_Table_Tail(n, d);
+}
+
+Sample* make_sample(SampleMethod method, size_t n, NB_distr* d)
+{
+    switch (method)
+    {
+    case method_bernulli:
+        return new Sample_Bernulli(n, d);
+    case method_bit_bernulli:
+        return new Sample_Bernulli_Bits(n, d);
+    case method_table:
+        return make_sample_table(n, d);
+    case method_int_table:
+        return new Sample_Table_Int(n, d);
+    default:
+        throw "make_sample: Unknown method.";
+    }
+}
+
+SampleCost sample_cost;
+
+SampleCost::SampleCost()
+{
+    // Измерено make bench на x86-64 (-O2) для minstd_rand0.
+    const double a0[num_sample_methods] = {12, 20, 23, 30};
+    const double b0[num_sample_methods] = {16, 2.5, 20, 0.9};
+
+    std::copy(a0, a0 + num_sample_methods, a);
+    std::copy(b0, b0 + num_sample_methods, b);
+}
+
+double SampleCost::work(SampleMethod method, const NB_distr* d, size_t n)
+{
+    double mean = d->get_k() * (1 - d->get_p()) / d->get_p();
+
+    switch (method)
+    {
+    case method_bernulli:
+    case method_bit_bernulli:
+        return d->get_k() / d->get_p();
+    case method_table:
+        return mean < sorted_min_mean ? mean : mean / n;
+    default:
+        return mean;
+    }
+}
+
+void SampleCost::calibrate(double budget)
+{
+    const size_t n = 1000;
+    NB_distr conf[2] = {NB_distr(0.8, 3), NB_distr(0.2, 20)};
+    std::default_random_engine g;
+
+    for (int m = 0; m < num_sample_methods; ++m)
+    {
+        double t[2], x[2];
+
+        for (int c = 0; c < 2; ++c)
+        {
+            Sample* s = make_sample(SampleMethod(m), n, &conf[c]);
+            size_t num = conf[c].get_num_states() + 1, reps = 0;
+            size_t* freq = new size_t[num]{};
+
+            s->set_generator(&g);
+
+            auto start = std::chrono::steady_clock::now();
+            double elapsed = 0;
+
+            for (; reps < 3 || elapsed < budget; ++reps)
+            {
+                s->simulate_freq(freq, num, conf[c].get_lo());
+                elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            }
+
+            t[c] = elapsed * 1e9 / reps / n;
+            x[c] = work(SampleMethod(m), &conf[c], n);
+
+            delete[] freq;
+            delete s;
+        }
+
+        // Прямая через две точки; отрицательные коэффициенты (шум измерения) заменяются нулём.
+        b[m] = x[1] > x[0] ? std::max(0.0, (t[1] - t[0]) / (x[1] - x[0])) : 0;
+        a[m] = std::max(0.0, t[0] - b[m] * x[0]);
+    }
+}
+
+double SampleCost::cost(SampleMethod method, const NB_distr* d, size_t n) const
+{
+    return n * (a[method] + b[method] * work(method, d, n));
+}
+
+SampleMethod SampleCost::fastest(const NB_distr* d, size_t n) const
+{
+    SampleMethod res = method_bernulli;
+
+    for (int m = 1; m < num_sample_methods; ++m)
+        if (cost(SampleMethod(m), d, n) < cost(res, d, n))
+            res = SampleMethod(m);
+
+    return res;
+}
+
+Sample_Bernulli::Sample_Bernulli(size_t _n, NB_distr* _d) : Sample(_n, _d)
+{
+
+}
+
+Sample_Bernulli::Sample_Bernulli(const Sample_Bernulli& s) : Sample(s)
+{
+
+}
+
+Sample_Bernulli::Sample_Bernulli(Sample_Bernulli&& s) : Sample(std::move(s))
+{
+    
+}
+
+Sample_Bernulli& Sample_Bernulli::operator=(Sample_Bernulli s)
+{
+    this->swap(s);
+
+    return *this;
+}
+
+const char* Sample_Bernulli::get_name() const
+{
+    return  "Bernulli Method";
+}
+
+size_t Sample_Bernulli::simulate_one()
+{
+    size_t l = 0, j = 0;
+
+    while (l != d->get_k())
+        uniform(*gen) > d->get_p() ? ++j : ++l;
+
+    return j;
+}
+
+void Sample_Bernulli::simulate_bulk(size_t* out, size_t count, std::default_random_engine& rng)
+{
+    bulk(out, count, rng, d->get_k(), d->get_p());
+}
+
+Sample* Sample_Bernulli::clone() const
+{
+    return new Sample_Bernulli(*this);
+}
+
+void ChiSqHist::swap(ChiSqHist& c)
+{
+    NB_distr* buff_d = d;
+    d = c.d, c.d = buff_d;
+    Sample* buff_s = s;
+    s = c.s, c.s = buff_s;
+    size_t buff_df = df;
+    df = c.df, c.df = buff_df;
+    double buff_chi_sq_stat = chi_sq_stat, buff_p_value = p_value;
+    chi_sq_stat = c.chi_sq_stat, c.chi_sq_stat = buff_chi_sq_stat;
+    p_value = c.p_value, c.p_value = buff_p_value;
+
+    size_t buff_num_freq = num_freq;
+    num_freq = c.num_freq, c.num_freq = buff_num_freq;
+    size_t* buff_exp_freq = exp_freq;
+    exp_freq = c.exp_freq, c.exp_freq = buff_exp_freq;
+    size_t buff_freq_n = freq_n;
+    freq_n = c.freq_n, c.freq_n = buff_freq_n;
+    th_freq.swap(c.th_freq);
+
+    size_t buff_plan_n = plan_n, buff_num_merge = num_merge;
+    plan_n = c.plan_n, c.plan_n = buff_plan_n;
+    num_merge = c.num_merge, c.num_merge = buff_num_merge;
+    merge_inx.swap(c.merge_inx);
+    th_merge.swap(c.th_merge);
+    size_t* buff_exp_merge = exp_merge;
+    exp_merge = c.exp_merge, c.exp_merge = buff_exp_merge;
+
+    bool buff_all_stats = all_stats;
+    all_stats = c.all_stats, c.all_stats = buff_all_stats;
+    std::swap_ranges(stat, stat + num_gof_stats, c.stat);
+    std::swap_ranges(stat_p_value, stat_p_value + num_gof_stats, c.stat_p_value);
+}
+
+ChiSqHist::ChiSqHist(NB_distr* _d, Sample* _s) : d(_d), s(_s), num_freq(10), freq_n(_s ? _s->get_n() : 0), plan_n(0), num_merge(0), all_stats(false), stat{}, stat_p_value{}
+{
+    exp_freq = new size_t[10];
+    th_freq = share_array(new double[10]);
+    exp_merge = new size_t[10];
+
+    if (_d && _s)
+    {
+        calc_th_freq();
+        calc_exp_freq();
+    }
+}
+
+ChiSqHist::ChiSqHist(const ChiSqHist& c) : d(c.d), s(c.s), df(c.df), chi_sq_stat(c.chi_sq_stat), p_value(c.p_value), num_freq(c.num_freq),
+                                           freq_n(c.freq_n), th_freq(c.th_freq), plan_n(c.plan_n), num_merge(c.num_merge), merge_inx(c.merge_inx),
+                                           th_merge(c.th_merge), all_stats(c.all_stats)
+{
+    std::copy(c.stat, c.stat + num_gof_stats, stat);
+    std::copy(c.stat_p_value, c.stat_p_value + num_gof_stats, stat_p_value);
+
+    exp_freq = new size_t[num_freq];
+    exp_merge = new size_t[num_freq];
+
+    memcpy(exp_freq, c.exp_freq, num_freq * sizeof(size_t));
+    memcpy(exp_merge, c.exp_merge, num_freq * sizeof(size_t));
+}
+
+ChiSqHist::ChiSqHist(ChiSqHist&& c) : d(nullptr), s(nullptr), df(0), chi_sq_stat(0), p_value(0), num_freq(0), exp_freq(nullptr),
+                                      freq_n(0), plan_n(0), num_merge(0), exp_merge(nullptr), all_stats(false), stat{}, stat_p_value{}
+{
+    this->swap(c);
+}
+
+ChiSqHist& ChiSqHist::operator=(ChiSqHist c)
+{
+    this->swap(c);
+
+    return *this;
+}
+
+void ChiSqHist::calc_th_freq()
+{
+    num_freq = d->get_num_states();
+
+    delete[] exp_merge;
+
+    exp_merge = new size_t[num_freq];
+    plan_n = 0;
+    merge_inx.reset();
+    th_merge.reset();
+
+    // Вероятности фиксированной гипотезы вычислены при компиляции и не освобождаются.
+    if (const FixedView* f = find_fixed(d->get_p(), d->get_k()))
+    {
+        th_freq = std::shared_ptr<const double>(f->prob, [](const double*) {});
+
+        return;
+    }
+
+    double* th = new double[num_freq];
+
+    d->reset();
+    th[0] = d->get_prob_now();
+
+    for (size_t i = 1; i < num_freq; ++i)
+        th[i] = d->next_prob();
+
+    // Хвосты за пределами окна распределения относятся к крайним состояниям, как и значения выборки.
+    th[0] += d->get_lower_tail();
+    th[num_freq - 1] += d->get_upper_tail();
+
+    // Таблицы, разделяемые с копиями, не изменяются - вместо них создаются новые.
+    th_freq = share_array(th);
+}
+
+void ChiSqHist::calc_exp_freq()
+{
+    delete[] exp_freq;
+
+    exp_freq = new size_t[num_freq]{};
+    freq_n = s->get_n();
+
+    s->count_freq(exp_freq, num_freq, d->get_lo());
+}
+
+void ChiSqHist::simulate_exp_freq()
+{
+    delete[] exp_freq;
+
+    exp_freq = new size_t[num_freq]{};
+    freq_n = s->get_n();
+
+    s->simulate_freq(exp_freq, num_freq, d->get_lo());
+}
+
+void ChiSqHist::simulate_exp_freq_parallel(size_t n, uint64_t stream, size_t threads)
+{
+    const size_t num_blocks = (n + parallel_block - 1) / parallel_block;
+    std::atomic<size_t> next(0);
+    std::mutex sum_mutex;
+    std::exception_ptr error;
+
+    delete[] exp_freq;
+
+    exp_freq = new size_t[num_freq]{};
+    freq_n = n;
+
+    auto worker = [&]()
+    {
+        Sample* local = nullptr;
+        std::default_random_engine rng;
+        size_t* buff = nullptr;
+        size_t* freq = nullptr;
+
+        // Исключение потока передаётся вызывающему потоку, иначе оно завершило бы программу.
+        try
+        {
+            // Копия разделяет таблицы с методом моделирования, но не копирует его выборку и моделирует своим генератором в свой буфер.
+            local = s->clone();
+            buff = new size_t[parallel_block];
+            freq = new size_t[num_freq]{};
+
+            for (size_t b = next++; b < num_blocks; b = next++)
+            {
+                size_t count = std::min(parallel_block, n - b * parallel_block);
+
+                rng.seed(block_seed(stream, b) % 2147483647);
+                local->simulate_bulk(buff, count, rng);
+                add_freq(SampleView<size_t>{buff, count}, freq, num_freq, d->get_lo());
+            }
+
+            // Сложение целых частот не зависит от порядка, поэтому результат не зависит от количества потоков.
+            std::lock_guard<std::mutex> lock(sum_mutex);
+
+            for (size_t j = 0; j < num_freq; ++j)
+                exp_freq[j] += freq[j];
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(sum_mutex);
+
+            if (!error)
+                error = std::current_exception();
+
+            next = num_blocks;
+        }
+
+        delete local;
+        delete[] buff;
+        delete[] freq;
+    };
+
+    if (!threads)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    std::vector<std::thread> pool;
+
+    for (size_t i = 1; i < threads && i < num_blocks; ++i)
+        pool.push_back(std::thread(worker));
+
+    worker();
+
+    for (size_t i = 0; i < pool.size(); ++i)
+        pool[i].join();
+
+    if (error)
+        std::rethrow_exception(error);
+}
+
+void ChiSqHist::set_sample(Sample* _s)
+{
+    s = _s;
+    freq_n = s->get_n();
+}
+
+void ChiSqHist::rebind(NB_distr* _d, Sample* _s)
+{
+    d = _d;
+    s = _s;
+    freq_n = s->get_n();
+}
+
+void ChiSqHist::set_data(NB_distr* _d, Sample* _s)
+{
+    d = _d;
+    s = _s;
+
+    calc_th_freq();
+    calc_exp_freq();
+}
+
+size_t ChiSqHist::merge_plan(size_t num, const double* th, size_t n, size_t* inx)
+{
+    size_t i = 0, j = 0;
+    double sum = 0;
+
+    for (; i < num; ++j)
+    {
+        sum = th[i];
+        inx[i] = j;
+        ++i;
+
+        for (; i < num && sum * n < 5; ++i)
+        {
+            sum += th[i];
+            inx[i] = j;
+        }
+    }
+
+    if (j > 1 && sum * n < 5)
+    {
+        --j;
+
+        for (i = num; i > 0 && inx[i - 1] == j; --i)
+            inx[i - 1] = j - 1;
+    }
+
+    return j;
+}
+
+void ChiSqHist::make_merge_plan()
+{
+    size_t* inx = new size_t[num_freq];
+    const double* th = th_freq.get();
+
+    plan_n = freq_n;
+    num_merge = merge_plan(num_freq, th, plan_n, inx);
+
+    double* th_m = new double[num_merge]{};
+
+    for (size_t i = 0; i < num_freq; ++i)
+        th_m[inx[i]] += th[i];
+
+    merge_inx = share_array(inx);
+    th_merge = share_array(th_m);
+}
+
+double ChiSqHist::chi_square()
+{
+    double res = 0, na_p;
+    const double* th_m = th_merge.get();
+
+    for (size_t i = 0; i < num_merge; ++i)
+    {
+        na_p = th_m[i] * freq_n;
+        res += (exp_merge[i] - na_p) * (exp_merge[i] - na_p) / na_p; 
+    }
+
+    return res;
+}
+
+void ChiSqHist::set_all_stats(bool _all_stats)
+{
+    all_stats = _all_stats;
+}
+
+void ChiSqHist::calc_all_stats()
+{
+    const size_t* inx = merge_inx.get();
+    const double* th = th_freq.get();
+    const double* th_m = th_merge.get();
+    double n = double(freq_n), cum_exp = 0, cum_th = 0, ks = 0, cvm = 0;
+
+    // Проход по состояниям: объединение частот и отклонения эмперической функции распределения от теоретической.
+    for (size_t i = 0; i < num_freq; ++i)
+    {
+        exp_merge[inx[i]] += exp_freq[i];
+
+        cum_exp += exp_freq[i];
+        cum_th += th[i];
+
+        double dev = cum_exp / n - cum_th;
+
+        ks = std::max(ks, fabs(dev));
+        cvm += dev * dev * th[i];
+    }
+
+    double pearson = 0, g = 0, ft = 0;
+
+    // Проход по объединённым состояниям: статистики, сравниваемые с распределением \chi^2.
+    for (size_t i = 0; i < num_merge; ++i)
+    {
+        double o = double(exp_merge[i]), e = th_m[i] * n;
+
+        pearson += (o - e) * (o - e) / e;
+        ft += (sqrt(o) - sqrt(e)) * (sqrt(o) - sqrt(e));
+
+        if (exp_merge[i])
+            g += o * log(o / e);
+    }
+
+    stat[stat_pearson] = pearson;
+    stat[stat_g] = 2 * g;
+    stat[stat_freeman_tukey] = 4 * ft;
+    stat[stat_ks] = sqrt(n) * ks;
+    stat[stat_cvm] = n * cvm;
+
+    for (int i = stat_pearson; i <= stat_freeman_tukey; ++i)
+        stat_p_value[i] = 1 - pChi(stat[i], df);
+
+    stat_p_value[stat_ks] = 1 - pKolmogorov(stat[stat_ks]);
+    stat_p_value[stat_cvm] = 1 - pCvM(stat[stat_cvm]);
+}
+
+void ChiSqHist::update_plan()
+{
+    if (plan_n != freq_n)
+        make_merge_plan();
+}
+
+void ChiSqHist::calc_chi_sq()
+{
+    update_plan();
+
+    const size_t* inx = merge_inx.get();
+
+    for (size_t i = 0; i < num_merge; ++i)
+        exp_merge[i] = 0;
+
+    df = num_merge - 1;
+
+    if (all_stats)
+    {
+        calc_all_stats();
+
+        chi_sq_stat = stat[stat_pearson];
+        p_value = stat_p_value[stat_pearson];
+
+        return;
+    }
+
+    for (size_t i = 0; i < num_freq; ++i)
+        exp_merge[inx[i]] += exp_freq[i];
+
+    chi_sq_stat = chi_square();
+    p_value = 1 - pChi(chi_sq_stat, df);
+
+    stat[stat_pearson] = chi_sq_stat;
+    stat_p_value[stat_pearson] = p_value;
+}
+
+ChiSqHist::~ChiSqHist()
+{
+    delete[] exp_freq;
+    delete[] exp_merge;
+}
+
+void chi_sq_p_values(const double* chi_sq, size_t num, size_t df, double* p_value)
+{
+    pChiBatch(chi_sq, int(num), int(df), p_value);
+
+    for (size_t i = 0; i < num; ++i)
+        p_value[i] = 1 - p_value[i];
+}
+
+void ChiSqPower::swap(ChiSqPower& c)
+{
+    NB_distr* buff_d0 = d0;
+    d0 = c.d0, c.d0 = buff_d0;
+    NB_distr* buff_d1 = d1;
+    d1 = c.d1, c.d1 = buff_d1;
+
+    size_t buff_num_freq = num_freq;
+    num_freq = c.num_freq, c.num_freq = buff_num_freq;
+    th0_freq.swap(c.th0_freq);
+    th1_freq.swap(c.th1_freq);
+    size_t* buff_merge_inx = merge_inx;
+    merge_inx = c.merge_inx, c.merge_inx = buff_merge_inx;
+}
+
+ChiSqPower::ChiSqPower(NB_distr* _d0, NB_distr* _d1) : d0(_d0), d1(_d1), num_freq(0), merge_inx(nullptr)
+{
+    if (_d0 && _d1)
+        calc_th_freq();
+}
+
+ChiSqPower::ChiSqPower(const ChiSqPower& c) : d0(c.d0), d1(c.d1), num_freq(c.num_freq), th0_freq(c.th0_freq), th1_freq(c.th1_freq)
+{
+    merge_inx = new size_t[num_freq];
+}
+
+ChiSqPower::ChiSqPower(ChiSqPower&& c) : d0(nullptr), d1(nullptr), num_freq(0), merge_inx(nullptr)
+{
+    this->swap(c);
+}
+
+ChiSqPower& ChiSqPower::operator=(ChiSqPower c)
+{
+    this->swap(c);
+
+    return *this;
+}
+
+void ChiSqPower::set_data(NB_distr* _d0, NB_distr* _d1)
+{
+    d0 = _d0;
+    d1 = _d1;
+
+    calc_th_freq();
+}
+
+void ChiSqPower::rebind(NB_distr* _d0, NB_distr* _d1)
+{
+    d0 = _d0;
+    d1 = _d1;
+}
+
+void ChiSqPower::calc_th_freq()
+{
+    num_freq = d0->get_num_states();
+
+    delete[] merge_inx;
+
+    double* th0 = new double[num_freq];
+    double* th1 = new double[num_freq]{};
+    merge_inx = new size_t[num_freq];
+
+    size_t lo = d0->get_lo(), lo1 = d1->get_lo(), num1 = d1->get_num_states();
+
+    d0->reset();
+    th0[0] = d0->get_prob_now();
+
+    for (size_t i = 1; i < num_freq; ++i)
+        th0[i] = d0->next_prob();
+
+    th0[0] += d0->get_lower_tail();
+    th0[num_freq - 1] += d0->get_upper_tail();
+
+    // Значения альтернативы за пределами окна нулевой гипотезы попадают в крайние состояния (как в ChiSqHist::calc_exp_freq).
+    d1->reset();
+    th1[freq_state(lo1, lo, num_freq)] += d1->get_prob_now() + d1->get_lower_tail();
+
+    for (size_t i = 1; i < num1; ++i)
+        th1[freq_state(lo1 + i, lo, num_freq)] += d1->next_prob();
+
+    th1[freq_state(lo1 + num1 - 1, lo, num_freq)] += d1->get_upper_tail();
+
+    th0_freq = share_array(th0);
+    th1_freq = share_array(th1);
+}
+
+double ChiSqPower::noncentrality(size_t n, size_t& df)
+{
+    const double* th0 = th0_freq.get();
+    const double* th1 = th1_freq.get();
+    size_t num_merge = ChiSqHist::merge_plan(num_freq, th0, n, merge_inx);
+    double* th0_merge = new double[num_merge]{};
+    double* th1_merge = new double[num_merge]{};
+    double res = 0;
+
+    for (size_t i = 0; i < num_freq; ++i)
+    {
+        th0_merge[merge_inx[i]] += th0[i];
+        th1_merge[merge_inx[i]] += th1[i];
+    }
+
+    for (size_t i = 0; i < num_merge; ++i)
+        res += (th1_merge[i] - th0_merge[i]) * (th1_merge[i] - th0_merge[i]) / th0_merge[i];
+
+    df = num_merge - 1;
+
+    delete[] th0_merge;
+    delete[] th1_merge;
+
+    return n * res;
+}
+
+double ChiSqPower::power(size_t n, double sign_lv)
+{
+    size_t df;
+    double lambda = noncentrality(n, df);
+
+    return 1 - pNonCentralChi(xChi(1 - sign_lv, df), df, lambda);
+}
+
+void ChiSqPower::power_curve(size_t num, const size_t* n_arr, double sign_lv, double* power_arr)
+{
+    for (size_t i = 0; i < num; ++i)
+        power_arr[i] = power(n_arr[i], sign_lv);
+}
+
+ChiSqPower::~ChiSqPower()
+{
+    delete[] merge_inx;
+}
+
+const char* gof_stat_name(GofStat stat)
+{
+    switch (stat)
+    {
+    case stat_pearson:
+        return "Pearson Chi-Square";
+    case stat_g:
+        return "G-Test";
+    case stat_freeman_tukey:
+        return "Freeman-Tukey";
+    case stat_ks:
+        return "Kolmogorov-Smirnov";
+    case stat_cvm:
+        return "Cramer-von Mises";
+    default:
+        return "Unknown Statistic";
+    }
+}
+
+void PValueSketch::swap(PValueSketch& ps)
+{
+    size_t buff_num_bins = num_bins;
+    num_bins = ps.num_bins, ps.num_bins = buff_num_bins;
+    size_t* buff_bins = bins;
+    bins = ps.bins, ps.bins = buff_bins;
+    size_t buff_count = count;
+    count = ps.count, ps.count = buff_count;
+    size_t* buff_cum = cum;
+    cum = ps.cum, ps.cum = buff_cum;
+}
+
+PValueSketch::PValueSketch(size_t _num_bins) : num_bins(_num_bins), count(0)
+{
+    if (num_bins == 0)
+        num_bins = 1;
+
+    bins = new size_t[num_bins]{};
+    cum = new size_t[num_bins + 1]{};
+}
+
+PValueSketch::PValueSketch(const PValueSketch& ps) : num_bins(ps.num_bins), count(ps.count)
+{
+    bins = new size_t[num_bins];
+    cum = new size_t[num_bins + 1];
+
+    memcpy(bins, ps.bins, num_bins * sizeof(size_t));
+    memcpy(cum, ps.cum, (num_bins + 1) * sizeof(size_t));
+}
+
+PValueSketch::PValueSketch(PValueSketch&& ps) : num_bins(0), bins(nullptr), count(0), cum(nullptr)
+{
+    this->swap(ps);
+}
+
+PValueSketch& PValueSketch::operator=(PValueSketch ps)
+{
+    this->swap(ps);
+
+    return *this;
+}
+
+void PValueSketch::merge(const PValueSketch& ps)
+{
+    if (num_bins != ps.num_bins)
+        throw "PValueSketch::merge: Sketches must have the same number of bins.";
+
+    for (size_t i = 0; i < num_bins; ++i)
+        bins[i] += ps.bins[i];
+
+    count += ps.count;
+    finish();
+}
+
+void PValueSketch::merge(const uint64_t* _bins, size_t _num_bins)
+{
+    if (num_bins != _num_bins)
+        throw "PValueSketch::merge: Sketches must have the same number of bins.";
+
+    for (size_t i = 0; i < num_bins; ++i)
+    {
+        bins[i] += _bins[i];
+        count += _bins[i];
+    }
+
+    finish();
+}
+
+void PValueSketch::clear()
+{
+    for (size_t i = 0; i < num_bins; ++i)
+        bins[i] = 0;
+
+    count = 0;
+    finish();
+}
+
+void PValueSketch::finish()
+{
+    cum[0] = 0;
+
+    for (size_t i = 0; i < num_bins; ++i)
+        cum[i + 1] = cum[i] + bins[i];
+}
+
+double PValueSketch::ecdf(double x) const
+{
+    size_t total = cum[num_bins];
+
+    if (total == 0 || x <= 0)
+        return 0;
+
+    if (x >= 1)
+        return 1;
+
+    double pos = x * num_bins;
+    size_t inx = size_t(pos);
+
+    return (cum[inx] + (pos - inx) * (cum[inx + 1] - cum[inx])) / total;
+}
+
+double PValueSketch::quantile(double q) const
+{
+    size_t total = cum[num_bins];
+
+    if (total == 0)
+        return 0;
+
+    // Первый непустой интервал, в котором накопленная сумма достигает rank.
+    double rank = q * total;
+    const size_t* first = cum + 1, * last = cum + num_bins + 1;
+    const size_t* it = rank > 0 ? std::lower_bound(first, last, rank) : std::upper_bound(first, last, size_t(0));
+
+    if (it == last)
+        return 1;
+
+    size_t i = it - cum - 1;
+
+    return (i + (rank - cum[i]) / (cum[i + 1] - cum[i])) / num_bins;
+}
+
+PValueSketch::~PValueSketch()
+{
+    delete[] bins;
+    delete[] cum;
+}
+
+void GofPValues::swap(GofPValues& g)
+{
+    size_t buff_num_p_value = num_p_value;
+    num_p_value = g.num_p_value, g.num_p_value = buff_num_p_value;
+    std::swap_ranges(arr, arr + num_gof_stats, g.arr);
+    std::swap_ranges(sketch, sketch + num_gof_stats, g.sketch);
+}
+
+GofPValues::GofPValues(size_t _num_p_value, size_t num_bins) : num_p_value(_num_p_value)
+{
+    for (int i = 0; i < num_gof_stats; ++i)
+    {
+        arr[i] = nullptr;
+        sketch[i] = nullptr;
+
+        if (i == stat_pearson)
+            continue;
+
+        if (num_bins)
+            sketch[i] = new PValueSketch(num_bins);
+        else
+            arr[i] = new double[num_p_value]{};
+    }
+}
+
+GofPValues::GofPValues(const GofPValues& g) : num_p_value(g.num_p_value)
+{
+    for (int i = 0; i < num_gof_stats; ++i)
+    {
+        arr[i] = nullptr;
+        sketch[i] = g.sketch[i] ? new PValueSketch(*g.sketch[i]) : nullptr;
+
+        if (g.arr[i])
+        {
+            arr[i] = new double[num_p_value];
+            memcpy(arr[i], g.arr[i], num_p_value * sizeof(double));
+        }
+    }
+}
+
+GofPValues::GofPValues(GofPValues&& g) : num_p_value(0), arr{}, sketch{}
+{
+    this->swap(g);
+}
+
+GofPValues& GofPValues::operator=(GofPValues g)
+{
+    this->swap(g);
+
+    return *this;
+}
+
+void GofPValues::add(size_t i, const double* p_value)
+{
+    for (int t = 0; t < num_gof_stats; ++t)
+    {
+        if (sketch[t])
+            sketch[t]->add(p_value[t]);
+        else if (arr[t])
+            arr[t][i] = p_value[t];
+    }
+}
+
+void GofPValues::finish()
+{
+    for (int t = 0; t < num_gof_stats; ++t)
+    {
+        if (sketch[t])
+            sketch[t]->finish();
+        else if (arr[t])
+            std::sort(arr[t], arr[t] + num_p_value);
+    }
+}
+
+double GofPValues::ecdf(GofStat stat, double x) const
+{
+    if (sketch[stat])
+        return sketch[stat]->ecdf(x);
+
+    if (!arr[stat])
+        throw "GofPValues::ecdf: No p-values are stored for the statistic.";
+
+    return double(std::lower_bound(arr[stat], arr[stat] + num_p_value, x) - arr[stat]) / num_p_value;
+}
+
+double GofPValues::quantile(GofStat stat, double q) const
+{
+    if (sketch[stat])
+        return sketch[stat]->quantile(q);
+
+    if (!arr[stat])
+        throw "GofPValues::quantile: No p-values are stored for the statistic.";
+
+    if (num_p_value == 0)
+        return 0;
+
+    size_t inx = q * num_p_value;
+
+    return arr[stat][inx < num_p_value ? inx : num_p_value - 1];
+}
+
+GofPValues::~GofPValues()
+{
+    for (int i = 0; i < num_gof_stats; ++i)
+    {
+        delete[] arr[i];
+        delete sketch[i];
+    }
+}
+
+void Doc_NB::rebind()
+{
+    if (s)
+    {
+        s->rebind(d_now);
+        s->set_generator(gen);
+    }
+
+    if (chisq)
+        chisq->rebind(&d0, s);
+
+    if (chipow)
+        chipow->rebind(&d0, d_now);
+}
+
+void Doc_NB::update()
+{
+    if (sample_dirty)
+    {
+        s->rebuild();
+        sample_dirty = false;
+    }
+
+    if (chisq_dirty)
+    {
+        chisq->set_data(&d0, s);
+        chisq_dirty = false;
+    }
+
+    if (chipow_dirty)
+    {
+        chipow->set_data(&d0, d_now);
+        chipow_dirty = false;
+    }
+}
+
+void Doc_NB::swap(Doc_NB& d)
+{
+    NB_distr buff_d0 = d0, buff_d1 = d1;
+    d0 = d.d0, d1 = d.d1;
+    d.d0 = buff_d0, d.d1 = buff_d1;
+    // d_now указывает на поле своего объекта, поэтому обмениваются не указатели, а выбранные гипотезы.
+    bool buff_hyp_d1 = d_now == &d1;
+    d_now = d.d_now == &d.d1 ? &d1 : &d0;
+    d.d_now = buff_hyp_d1 ? &d.d1 : &d.d0;
+    Sample* buff_s = s;
+    s = d.s;
+    d.s = buff_s;
+    ChiSqHist *buff_chisq = chisq;
+    chisq = d.chisq;
+    d.chisq = buff_chisq;
+    ChiSqPower *buff_chipow = chipow;
+    chipow = d.chipow;
+    d.chipow = buff_chipow;
+    std::default_random_engine buff_own_gen = own_gen;
+    own_gen = d.own_gen;
+    d.own_gen = buff_own_gen;
+    std::default_random_engine* buff_gen = gen == &own_gen ? &d.own_gen : gen;
+    gen = d.gen == &d.own_gen ? &own_gen : d.gen;
+    d.gen = buff_gen;
+    SampleMethod buff_method = method;
+    method = d.method;
+    d.method = buff_method;
+    bool buff_auto_method = auto_method;
+    auto_method = d.auto_method;
+    d.auto_method = buff_auto_method;
+    bool buff_sample_dirty = sample_dirty, buff_chisq_dirty = chisq_dirty, buff_chipow_dirty = chipow_dirty;
+    sample_dirty = d.sample_dirty, chisq_dirty = d.chisq_dirty, chipow_dirty = d.chipow_dirty;
+    d.sample_dirty = buff_sample_dirty, d.chisq_dirty = buff_chisq_dirty, d.chipow_dirty = buff_chipow_dirty;
+    bool buff_p_value_ready = p_value_ready;
+    p_value_ready = d.p_value_ready;
+    d.p_value_ready = buff_p_value_ready;
+
+    size_t buff_num_p_value = num_p_value;
+    num_p_value = d.num_p_value;
+    d.num_p_value = buff_num_p_value;
+    double buff_sign_lv = sign_lv;
+    sign_lv = d.sign_lv;
+    d.sign_lv = buff_sign_lv;
+    double* buff_p_value_arr = p_value_arr;
+    p_value_arr = d.p_value_arr;
+    d.p_value_arr = buff_p_value_arr;
+    PValueSketch* buff_sketch = sketch;
+    sketch = d.sketch;
+    d.sketch = buff_sketch;
+    GofPValues* buff_gof = gof;
+    gof = d.gof;
+    d.gof = buff_gof;
+    size_t buff_analytic_min_n = analytic_min_n;
+    analytic_min_n = d.analytic_min_n;
+    d.analytic_min_n = buff_analytic_min_n;
+    size_t buff_range_begin = range_begin;
+    range_begin = d.range_begin;
+    d.range_begin = buff_range_begin;
+    bool buff_range_mode = range_mode;
+    range_mode = d.range_mode;
+    d.range_mode = buff_range_mode;
+    checkpoint_path.swap(d.checkpoint_path);
+    size_t buff_checkpoint_every = checkpoint_every;
+    checkpoint_every = d.checkpoint_every;
+    d.checkpoint_every = buff_checkpoint_every;
+    ResultCache* buff_cache = cache;
+    cache = d.cache;
+    d.cache = buff_cache;
+
+    rebind();
+    d.rebind();
+}
+
+Doc_NB::Doc_NB() : d0(), d1(), num_p_value(10000), d_now(&d0), sign_lv(0.05), analytic_min_n(100), range_begin(0), range_mode(false),
+                   checkpoint_every(100000), cache(nullptr)
+{
+    gen = &generator;
+    method = method_bernulli;
+    auto_method = false;
+    sample_dirty = chisq_dirty = chipow_dirty = false;
+    p_value_ready = false;
+    s = new Sample_Bernulli(100, d_now);
+    chisq = new ChiSqHist(d_now, s);
+    chipow = new ChiSqPower(&d0, d_now);
+    p_value_arr = new double[num_p_value]{};
+    sketch = nullptr;
+    gof = nullptr;
+}
+
+Doc_NB::Doc_NB(const Doc_NB &d) : d0(d.d0), d1(d.d1), d_now(d.d_now == &d.d1 ? &d1 : &d0), num_p_value(d.num_p_value), sign_lv(d.sign_lv),
+                                   analytic_min_n(d.analytic_min_n), range_begin(d.range_begin), range_mode(d.range_mode),
+                                   checkpoint_path(d.checkpoint_path), checkpoint_every(d.checkpoint_every), cache(d.cache), own_gen(*d.gen)
+{
+    gen = &own_gen;
+    method = d.method;
+    auto_method = d.auto_method;
+    sample_dirty = d.sample_dirty;
+    chisq_dirty = d.chisq_dirty;
+    chipow_dirty = d.chipow_dirty;
+    p_value_ready = d.p_value_ready;
+    s = d.s->clone();
+    chisq = new ChiSqHist(*d.chisq);
+    chipow = new ChiSqPower(*d.chipow);
+    rebind();
+
+    p_value_arr = nullptr;
+    sketch = nullptr;
+    gof = d.gof ? new GofPValues(*d.gof) : nullptr;
+
+    if (d.sketch)
+        sketch = new PValueSketch(*d.sketch);
+    else
+    {
+        p_value_arr = new double[num_p_value]{};
+        memcpy(p_value_arr, d.p_value_arr, num_p_value * sizeof(double));
+    }
+}
+
+Doc_NB::Doc_NB(Doc_NB &&d) : d_now(&d0), s(nullptr), chisq(nullptr), chipow(nullptr), gen(&generator), method(method_bernulli), auto_method(false),
+                              sample_dirty(false), chisq_dirty(false), chipow_dirty(false), p_value_ready(false), num_p_value(0), sign_lv(0.05),
+                              p_value_arr(nullptr), sketch(nullptr), gof(nullptr), analytic_min_n(100), range_begin(0), range_mode(false),
+                              checkpoint_every(100000), cache(nullptr)
+{
+    this->swap(d);
+}
+
+Doc_NB& Doc_NB::operator=(Doc_NB d)
+{
+    this->swap(d);
+
+    return *this;
+}
+
+double Doc_NB::get_p_value(size_t i) const
+{
+    if (i >= num_p_value)
+        return -1;
+
+    if (sketch)
+        return sketch->quantile((i + 0.5) / num_p_value);
+
+    return p_value_arr[i];
+}
+
+double Doc_NB::p_value_ecdf(double x) const
+{
+    if (sketch)
+        return sketch->ecdf(x);
+
+    return double(std::lower_bound(p_value_arr, p_value_arr + num_p_value, x) - p_value_arr) / num_p_value;
+}
+
+double Doc_NB::p_value_quantile(double q) const
+{
+    if (sketch)
+        return sketch->quantile(q);
+
+    if (num_p_value == 0)
+        return 0;
+
+    size_t inx = q * num_p_value;
+
+    return p_value_arr[inx < num_p_value ? inx : num_p_value - 1];
+}
+
+void Doc_NB::fill_header(ResultHeader& head) const
+{
+    head = ResultHeader();
+    head.d0_p = d0.get_p();
+    head.d0_k = d0.get_k();
+    head.d1_p = d1.get_p();
+    head.d1_k = d1.get_k();
+    head.n = s->get_n();
+    head.num_p_value = num_p_value;
+    head.sign_lv = sign_lv;
+    head.seed = seed;
+    head.hyp = d_now == &d1;
+    strncpy(head.method, s->get_name(), sizeof(head.method) - 1);
+}
+
+void Doc_NB::save_result(const char* path, unsigned flags) const
+{
+    ResultHeader head;
+    ResultColumn columns[4];
+    size_t num_columns = 0, n = s->get_n();
+    uint64_t* sample = nullptr;
+    uint64_t* exp_freq = nullptr;
+
+    fill_header(head);
+
+    if (sketch)
+    {
+        uint64_t* bins = new uint64_t[sketch->get_num_bins()];
+
+        for (size_t i = 0; i < sketch->get_num_bins(); ++i)
+            bins[i] = sketch->get_bins()[i];
+
+        columns[num_columns++] = {column_sketch, type_u64, sketch->get_num_bins(), bins};
+    }
+    else
+        columns[num_columns++] = {column_p_value, type_f64, num_p_value, p_value_arr};
+
+    if (flags & result_sample)
+    {
+        sample = new uint64_t[n];
+
+        for (size_t i = 0; i < n; ++i)
+            sample[i] = (*s)[i];
+
+        columns[num_columns++] = {column_sample, type_u64, n, sample};
+    }
+
+    if (flags & result_hist)
+    {
+        exp_freq = new uint64_t[chisq->get_num_freq()];
+
+        for (size_t i = 0; i < chisq->get_num_freq(); ++i)
+            exp_freq[i] = chisq->get_exp_freq()[i];
+
+        columns[num_columns++] = {column_exp_freq, type_u64, chisq->get_num_freq(), exp_freq};
+        columns[num_columns++] = {column_th_freq, type_f64, chisq->get_num_freq(), chisq->get_th_freq()};
+    }
+
+    try
+    {
+        write_result(path, head, num_columns, columns);
+    }
+    catch (...)
+    {
+        if (sketch)
+            delete[] (const uint64_t*)columns[0].data;
+
+        delete[] sample;
+        delete[] exp_freq;
+
+        throw;
+    }
+
+    if (sketch)
+        delete[] (const uint64_t*)columns[0].data;
+
+    delete[] sample;
+    delete[] exp_freq;
+}
+
+void Doc_NB::set_array_storage()
+{
+    if (!sketch)
+        return;
+
+    delete sketch;
+    sketch = nullptr;
+
+    p_value_arr = new double[num_p_value]{};
+    reset_gof();
+    p_value_ready = false;
+}
+
+void Doc_NB::set_sketch_storage(size_t num_bins)
+{
+    if (sketch && sketch->get_num_bins() == std::max<size_t>(num_bins, 1))
+        return;
+
+    delete[] p_value_arr;
+    p_value_arr = nullptr;
+
+    delete sketch;
+    sketch = new PValueSketch(num_bins);
+    reset_gof();
+    p_value_ready = false;
+}
+
+void Doc_NB::reset_gof()
+{
+    if (!gof)
+        return;
+
+    delete gof;
+    gof = new GofPValues(num_p_value, sketch ? sketch->get_num_bins() : 0);
+}
+
+void Doc_NB::set_all_stats(bool all_stats)
+{
+    chisq->set_all_stats(all_stats);
+
+    delete gof;
+    gof = all_stats ? new GofPValues(num_p_value, sketch ? sketch->get_num_bins() : 0) : nullptr;
+
+    if (all_stats)
+        p_value_ready = false;
+}
+
+double Doc_NB::stat_ecdf(GofStat stat, double x) const
+{
+    if (stat == stat_pearson)
+        return p_value_ecdf(x);
+
+    if (!gof)
+        throw "Doc_NB::stat_ecdf: Additional statistics are not computed.";
+
+    return gof->ecdf(stat, x);
+}
+
+double Doc_NB::stat_quantile(GofStat stat, double q) const
+{
+    if (stat == stat_pearson)
+        return p_value_quantile(q);
+
+    if (!gof)
+        throw "Doc_NB::stat_quantile: Additional statistics are not computed.";
+
+    return gof->quantile(stat, q);
+}
+
+int comp(const void *a, const void *b)
+{
+    if (*(const double*)a > *(const double*)b)
+        return 1;
+    else
+        return -1;
+}
+
+int seek64(FILE* f, uint64_t pos)
+{
+#ifdef _WIN32
+    return _fseeki64(f, pos, SEEK_SET);
+#else
+    return fseeko(f, pos, SEEK_SET);
+#endif
+}
+
+void write_checkpoint(std::string path, ResultHeader head, size_t index, std::string rng_state, PValueSketch* sketch,
+                      const double* p_value_arr, size_t from, bool range_mode, size_t range_begin)
+{
+    try
+    {
+        if (p_value_arr)
+        {
+            std::string pv_path = path + ".pv";
+            FILE* f = fopen(pv_path.c_str(), from == 0 ? "wb" : "r+b");
+            bool ok = f && seek64(f, uint64_t(from) * sizeof(double)) == 0;
+
+            ok = ok && fwrite(p_value_arr + from, sizeof(double), index - from, f) == index - from;
+
+            if (!f || fclose(f) != 0 || !ok)
+                throw "write_checkpoint: Error while writing p-values.";
+        }
 
-    for (size_t i = 0; i < num_freq; ++j)
+        uint64_t replicate = index, range[2] = {range_begin, range_begin + head.num_p_value};
+        ResultColumn columns[4] = {{column_replicate, type_u64, 1, &replicate},
+                                   {column_rng_state, type_u8, rng_state.size(), rng_state.data()}};
+        size_t num_columns = 2;
+        std::string tmp_path = path + ".tmp";
+
+        if (sketch)
+            columns[num_columns++] = {column_sketch, type_u64, sketch->get_num_bins(), sketch->get_bins()};
+
+        if (range_mode)
+            columns[num_columns++] = {column_range, type_u64, 2, range};
+
+        write_result(tmp_path.c_str(), head, num_columns, columns);
+
+#ifdef _WIN32
+        remove(path.c_str());
+#endif
+        if (rename(tmp_path.c_str(), path.c_str()) != 0)
+            throw "write_checkpoint: Unable to replace checkpoint file.";
+    }
+    catch (const char* e)
     {
-        th_freq_merge[j] = th_freq_merge[i];
-        exp_freq_merge[j] = exp_freq_merge[i];
-        ++i;
+        std::cerr << e << "\n";
+    }
+
+    delete sketch;
+}
+
+bool same_experiment(const ResultHeader& a, const ResultHeader& b)
+{
+    return a.d0_p == b.d0_p && a.d0_k == b.d0_k && a.d1_p == b.d1_p && a.d1_k == b.d1_k && a.n == b.n && a.hyp == b.hyp &&
+           strncmp(a.method, b.method, sizeof(a.method)) == 0;
+}
+
+uint64_t mix_seed(uint64_t x)
+{
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+
+    return x ^ (x >> 31);
+}
 
-        for (; i < num_freq; ++i)
+uint64_t replicate_seed(uint64_t i)
+{
+    return mix_seed(mix_seed(seed) + i);
+}
+
+uint64_t block_seed(uint64_t stream, uint64_t block)
+{
+    return mix_seed(replicate_seed(stream) + block);
+}
+
+void Doc_NB::run_p_value(size_t from)
+{
+    std::thread writer;
+    ResultHeader head;
+    size_t written = from;
+
+    update();
+
+    if (!checkpoint_path.empty())
+        fill_header(head);
+
+    for (size_t i = from; i < num_p_value; ++i)
+    {
+        if (!checkpoint_path.empty() && i != from && i % checkpoint_every == 0)
         {
-            if (th_freq_merge[j] * s->get_n() >= 5)
-                break;
-            else
-            {
-                th_freq_merge[j] += th_freq_merge[i];
-                exp_freq_merge[j] += exp_freq_merge[i];
-            }
+            // Пока поток записи занят, p-value до i не меняются, поэтому массив передаётся без копирования.
+            std::ostringstream rng_state;
+            rng_state << *gen;
+
+            if (writer.joinable())
+                writer.join();
+
+            writer = std::thread(write_checkpoint, checkpoint_path, head, i, rng_state.str(),
+                                 sketch ? new PValueSketch(*sketch) : nullptr, p_value_arr, written, range_mode, range_begin);
+            written = i;
         }
 
-        if (i == num_freq && th_freq_merge[j] * s->get_n() < 5)
+        if (range_mode)
+            gen->seed(replicate_seed(range_begin + i) % 2147483647);
+
+        chisq->simulate_exp_freq();
+        chisq->calc_chi_sq();
+
+        if (sketch)
+            sketch->add(chisq->get_p_value());
+        else
+            p_value_arr[i] = chisq->get_p_value();
+
+        if (gof)
+            gof->add(i, chisq->get_stat_p_values());
+    }
+
+    if (writer.joinable())
+        writer.join();
+
+    if (!checkpoint_path.empty())
+    {
+        remove(checkpoint_path.c_str());
+        remove((checkpoint_path + ".pv").c_str());
+    }
+
+    if (sketch)
+        sketch->finish();
+    else
+        qsort(p_value_arr, num_p_value, sizeof(double), comp);
+
+    if (gof)
+        gof->finish();
+}
+
+void Doc_NB::make_p_value()
+{
+    if (p_value_ready)
+        return;
+
+    // Дополнительные статистики в кэше не хранятся, поэтому с ними выборка всегда моделируется.
+    bool use_cache = cache && !gof;
+    uint64_t key = use_cache ? cache_key() : 0;
+
+    if (use_cache && load_cached(key))
+    {
+        p_value_ready = true;
+
+        return;
+    }
+
+    if (sketch)
+        sketch->clear();
+
+    reset_gof();
+
+    // Каждое повторение моделируется из своего потока генератора, поэтому выборка не зависит от того, задан ли кэш.
+    range_begin = 0;
+    range_mode = true;
+    run_p_value(0);
+    p_value_ready = true;
+
+    if (use_cache)
+        store_cached(key);
+}
+
+uint64_t Doc_NB::cache_key() const
+{
+    ResultHeader head;
+
+    fill_header(head);
+
+    return experiment_key(head, sketch ? sketch->get_num_bins() : 0);
+}
+
+bool Doc_NB::load_cached(uint64_t key)
+{
+    if (!cache->find(key))
+        return false;
+
+    try
+    {
+        Result_NB r(cache->path(key).c_str());
+        ResultHeader head;
+        size_t count;
+
+        fill_header(head);
+
+        // Совпадение ключей разных экспериментов маловероятно, но проверяется по заголовку.
+        if (!same_experiment(r.get_header(), head) || r.get_header().seed != head.seed || r.get_header().num_p_value != num_p_value)
+            return false;
+
+        if (sketch)
         {
-            --j;
-            th_freq_merge[j] += th_freq_merge[i - 1];
-            exp_freq_merge[j] += exp_freq_merge[i - 1];
+            const uint64_t* bins = r.get_sketch(count);
+
+            if (!bins || count != sketch->get_num_bins())
+                return false;
+
+            sketch->clear();
+            sketch->merge(bins, count);
+        }
+        else
+        {
+            const double* pv = r.get_p_value(count);
+
+            if (!pv || count != num_p_value)
+                return false;
+
+            memcpy(p_value_arr, pv, num_p_value * sizeof(double));
         }
     }
+    catch (const char*)
+    {
+        return false;
+    }
 
-    return j;
+    range_begin = 0;
+    range_mode = true;
+
+    return true;
 }
 
-double ChiSqHist::chi_square(size_t new_num, size_t* exp_freq_merge, double* th_freq_merge)
+void Doc_NB::store_cached(uint64_t key) const
 {
-    double res = 0, na_p;
+    std::string tmp = cache->temp_path(key);
 
-    for (size_t i = 0; i < new_num; ++i)
+    try
     {
-        na_p = th_freq_merge[i] * s->get_n();
-        res += (exp_freq_merge[i] - na_p) * (exp_freq_merge[i] - na_p) / na_p; 
+        save_result(tmp.c_str());
+        cache->commit(key, tmp);
+    }
+    catch (const char* e)
+    {
+        remove(tmp.c_str());
+        std::cerr << e << "\n";
     }
-
-    return res;
 }
 
-void ChiSqHist::calc_chi_sq()
+void Doc_NB::set_cache(ResultCache* _cache)
 {
-    double* th_freq_merge = new double[num_freq];
-    size_t* exp_freq_merge = new size_t[num_freq];
+    cache = _cache;
+}
 
-    memcpy(th_freq_merge, th_freq, num_freq * sizeof(double));
-    memcpy(exp_freq_merge, exp_freq, num_freq * sizeof(size_t));
+void Doc_NB::discard_p_value()
+{
+    p_value_ready = false;
+}
 
-    size_t new_num = merge(exp_freq_merge, th_freq_merge);
+void Doc_NB::make_p_value_range(size_t begin, size_t end)
+{
+    if (end < begin)
+        throw "Doc_NB::make_p_value_range: The end of the range must not be less than its beginning.";
 
-    chi_sq_stat = chi_square(new_num, exp_freq_merge, th_freq_merge);
-    df = new_num - 1;
-    p_value = 1 - pChi(chi_sq_stat, df);
+    resize_p_value(end - begin);
 
-    delete[] th_freq_merge;
-    delete[] exp_freq_merge;
+    range_begin = begin;
+    range_mode = true;
+    run_p_value(0);
 }
 
-ChiSqHist::~ChiSqHist()
+void Doc_NB::save_shard(const char* path) const
 {
-    delete[] exp_freq;
-    delete[] th_freq;
+    ResultHeader head;
+    uint64_t range[2] = {range_begin, range_begin + num_p_value};
+    ResultColumn columns[2] = {{column_range, type_u64, 2, range}};
+
+    if (!range_mode)
+        throw "Doc_NB::save_shard: The result was not made by make_p_value_range.";
+
+    fill_header(head);
+
+    if (sketch)
+        columns[1] = {column_sketch, type_u64, sketch->get_num_bins(), sketch->get_bins()};
+    else
+        columns[1] = {column_p_value, type_f64, num_p_value, p_value_arr};
+
+    write_result(path, head, 2, columns);
 }
 
-void Doc_NB::swap(Doc_NB& d)
+void Doc_NB::merge_shards(size_t num, const char* const* paths)
 {
-    NB_distr buff_d0 = d0, buff_d1 = d1;
-    d0 = d.d0, d1 = d.d1;
-    d.d0 = buff_d0, d.d1 = buff_d1;
-    NB_distr* buff_d_now = d_now;
-    d_now = d.d_now;
-    d.d_now = buff_d_now;
-    Sample* buff_s = s;
-    s = d.s;
-    d.s = buff_s;
-    ChiSqHist *buff_chisq = chisq;
-    chisq = d.chisq;
-    d.chisq = buff_chisq;
+    if (gof)
+        throw "Doc_NB::merge_shards: Additional statistics are not stored in shards.";
 
-    size_t buff_num_p_value = num_p_value;
-    num_p_value = d.num_p_value;
-    d.num_p_value = buff_num_p_value;
-    double buff_sign_lv = sign_lv;
-    sign_lv = d.sign_lv;
-    d.sign_lv = buff_sign_lv;
-    double* buff_p_value_arr = p_value_arr;
-    p_value_arr = d.p_value_arr;
-    d.p_value_arr = buff_p_value_arr;
+    ResultHeader head;
+    size_t total = 0, count;
+    uint64_t* range_begins = new uint64_t[num];
+    uint64_t* range_ends = new uint64_t[num];
+
+    update();
+    fill_header(head);
+
+    try
+    {
+        for (size_t i = 0; i < num; ++i)
+        {
+            Result_NB shard(paths[i]);
+            const uint64_t* range = (const uint64_t*)shard.get_column(column_range, type_u64, count);
+
+            if (!same_experiment(shard.get_header(), head) || shard.get_header().seed != head.seed)
+                throw "Doc_NB::merge_shards: Shard was made for other parameters or seed.";
+
+            if (!range || count != 2 || range[1] - range[0] != shard.get_header().num_p_value)
+                throw "Doc_NB::merge_shards: Shard has no valid range of replicates.";
+
+            range_begins[i] = range[0];
+            range_ends[i] = range[1];
+            total += range[1] - range[0];
+        }
+
+        // Непересекающиеся диапазоны внутри [0, total) с суммарной длиной total покрывают его целиком.
+        for (size_t i = 0; i < num; ++i)
+            for (size_t j = i + 1; j < num; ++j)
+                if (range_begins[i] < range_ends[j] && range_begins[j] < range_ends[i])
+                    throw "Doc_NB::merge_shards: Ranges of shards overlap.";
+
+        for (size_t i = 0; i < num; ++i)
+            if (range_ends[i] > total)
+                throw "Doc_NB::merge_shards: Ranges of shards do not cover all replicates.";
+
+        resize_p_value(total);
+
+        for (size_t i = 0; i < num; ++i)
+        {
+            Result_NB shard(paths[i]);
+
+            if (sketch)
+            {
+                const uint64_t* bins = shard.get_sketch(count);
+
+                if (!bins)
+                    throw "Doc_NB::merge_shards: Shard does not contain a sketch.";
+
+                uint64_t num_bin_p_value = 0;
+
+                for (size_t j = 0; j < count; ++j)
+                    num_bin_p_value += bins[j];
+
+                if (num_bin_p_value != range_ends[i] - range_begins[i])
+                    throw "Doc_NB::merge_shards: Shard sketch does not match its range.";
+
+                sketch->merge(bins, count);
+            }
+            else
+            {
+                const double* pv = shard.get_p_value(count);
+
+                if (!pv)
+                    throw "Doc_NB::merge_shards: Shard does not contain p-values.";
+
+                if (count != range_ends[i] - range_begins[i])
+                    throw "Doc_NB::merge_shards: Shard p-values do not match its range.";
+
+                memcpy(p_value_arr + range_begins[i], pv, count * sizeof(double));
+            }
+        }
+    }
+    catch (...)
+    {
+        delete[] range_begins;
+        delete[] range_ends;
+
+        throw;
+    }
+
+    delete[] range_begins;
+    delete[] range_ends;
+
+    if (!sketch)
+        qsort(p_value_arr, num_p_value, sizeof(double), comp);
+
+    range_begin = 0;
+    range_mode = true;
+    p_value_ready = true;
 }
 
-Doc_NB::Doc_NB() : d0(), d1(), num_p_value(10000), d_now(&d0), sign_lv(0.05)
+void Doc_NB::set_checkpoint(const char* path, size_t every)
 {
-    s = new Sample_Bernulli(100, d_now);
-    chisq = new ChiSqHist(d_now, s);
-    p_value_arr = new double[num_p_value]{};
+    checkpoint_path = path ? path : "";
+    checkpoint_every = every > 0 ? every : 1;
 }
 
-Doc_NB::Doc_NB(Doc_NB &d) : d0(d.d0), d1(d.d1), num_p_value(d.num_p_value), sign_lv(d.sign_lv), s(d.s), chisq(d.chisq)
+void Doc_NB::resume_p_value(const char* path)
 {
-    p_value_arr = new double[num_p_value]{};
-    memcpy(p_value_arr, d.p_value_arr, num_p_value * sizeof(double));
+    if (gof)
+        throw "Doc_NB::resume_p_value: Additional statistics are not stored in checkpoints.";
+
+    Result_NB cp(path);
+    ResultHeader head;
+    size_t count, index;
+
+    fill_header(head);
+
+    const ResultHeader& cp_head = cp.get_header();
+
+    if (!same_experiment(cp_head, head) || cp_head.num_p_value != head.num_p_value)
+        throw "Doc_NB::resume_p_value: Checkpoint was saved for other parameters.";
+
+    if (cp_head.seed != head.seed)
+        throw "Doc_NB::resume_p_value: Checkpoint was saved with other seed.";
+
+    const uint64_t* range = (const uint64_t*)cp.get_column(column_range, type_u64, count);
+
+    range_mode = range && count == 2;
+    range_begin = range_mode ? range[0] : 0;
+
+    const uint64_t* replicate = (const uint64_t*)cp.get_column(column_replicate, type_u64, count);
+    const char* rng_state = (const char*)cp.get_column(column_rng_state, type_u8, count);
+
+    if (!replicate || !rng_state)
+        throw "Doc_NB::resume_p_value: Checkpoint is damaged.";
+
+    index = *replicate;
+
+    if (index > num_p_value)
+        throw "Doc_NB::resume_p_value: Checkpoint is damaged.";
+
+    std::istringstream rng_in(std::string(rng_state, count));
+    rng_in >> *gen;
+
+    if (sketch)
+    {
+        const uint64_t* bins = cp.get_sketch(count);
+
+        if (!bins || count != sketch->get_num_bins())
+            throw "Doc_NB::resume_p_value: Checkpoint does not contain a sketch of the same size.";
+
+        sketch->clear();
+        sketch->merge(bins, count);
+    }
+    else
+    {
+        std::string pv_path = std::string(path) + ".pv";
+        FILE* f = fopen(pv_path.c_str(), "rb");
+        bool ok = f && fread(p_value_arr, sizeof(double), index, f) == index;
+
+        if (f)
+            fclose(f);
+
+        if (!ok)
+            throw "Doc_NB::resume_p_value: Unable to read p-values of the checkpoint.";
+    }
+
+    set_checkpoint(path, checkpoint_every);
+    p_value_ready = false;
+    run_p_value(index);
+
+    // Продолженное моделирование совпадает с make_p_value, если повторения моделировались из своих потоков начиная с нулевого.
+    p_value_ready = range_mode && range_begin == 0;
 }
 
-Doc_NB::Doc_NB(Doc_NB &&d)
+double Doc_NB::simulate_power(size_t n)
 {
-    this->swap(d);
+    size_t back_n = s->get_n();
+
+    if (n == back_n)
+    {
+        make_p_value();
+
+        return p_value_ecdf(sign_lv);
+    }
+
+    s->change_param(n);
+    p_value_ready = false;
+    make_p_value();
+    s->change_param(back_n);
+
+    // Выборка p-value получена для другого размера выборки.
+    p_value_ready = false;
+
+    return p_value_ecdf(sign_lv);
 }
 
-Doc_NB& Doc_NB::operator=(Doc_NB d)
+double Doc_NB::analytic_power(size_t n)
 {
-    this->swap(d);
+    update();
 
-    return *this;
+    return chipow->power(n, sign_lv);
 }
 
-double Doc_NB::get_p_value(size_t i) const
+double Doc_NB::check_power(size_t n)
 {
-    if(i < num_p_value)
-        return p_value_arr[i];
-    else
-        return -1;
+    return fabs(analytic_power(n) - simulate_power(n));
 }
 
-int comp(const void *a, const void *b)
+void Doc_NB::power_curve(size_t num, const size_t* n_arr, double* power_arr)
 {
-    if (*(const double*)a > *(const double*)b)
-        return 1;
-    else
-        return -1;
+    for (size_t i = 0; i < num; ++i)
+        power_arr[i] = n_arr[i] >= analytic_min_n ? analytic_power(n_arr[i]) : simulate_power(n_arr[i]);
 }
 
-void Doc_NB::make_p_value()
+void Doc_NB::set_analytic_min_n(size_t _analytic_min_n)
+{
+    analytic_min_n = _analytic_min_n;
+}
+
+void Doc_NB::resize_p_value(size_t _num_p_value)
 {
-    for (size_t i = 0; i < num_p_value; ++i)
+    num_p_value = _num_p_value;
+
+    if (sketch)
+        sketch->clear();
+    else
     {
-        s->simulate();
-        chisq->calc_exp_freq();
-        chisq->calc_chi_sq();
-        p_value_arr[i] = chisq->get_p_value();
+        delete[] p_value_arr;
+        p_value_arr = new double[num_p_value]{};
     }
 
-    qsort(p_value_arr, num_p_value, sizeof(double), comp);
+    reset_gof();
+    p_value_ready = false;
 }
 
 void Doc_NB::change_param(NB_distr _d0, NB_distr _d1, size_t _num_p_value, size_t _n, double _sign_lv)
 {
-    d0 = _d0;
-    d1 = _d1;
-    num_p_value = _num_p_value;
+    bool d0_changed = d0 != _d0, d1_changed = d1 != _d1;
+    bool d_now_changed = d_now == &d0 ? d0_changed : d1_changed;
+
+    if (d0_changed)
+    {
+        d0 = _d0;
+        chisq_dirty = true;
+    }
+
+    if (d1_changed)
+        d1 = _d1;
+
+    if (d_now_changed)
+        sample_dirty = true;
+
+    if (d0_changed || d_now_changed)
+    {
+        chipow_dirty = true;
+        p_value_ready = false;
+    }
+
+    // Уровень значимости не влияет на выборку p-value, поэтому после его изменения она используется повторно.
     sign_lv = _sign_lv;
 
-    delete[] p_value_arr;
-    p_value_arr = new double[num_p_value]{};
+    if (_num_p_value != num_p_value)
+        resize_p_value(_num_p_value);
 
-    s->change_param(_n);
+    if (_n != s->get_n())
+    {
+        s->change_param(_n);
+        p_value_ready = false;
+    }
+}
 
-    chisq->set_data(&d0, s);
+void Doc_NB::set_generator(std::default_random_engine* _gen)
+{
+    gen = _gen;
+    s->set_generator(gen);
+    p_value_ready = false;
 }
 
-void Doc_NB::set_table_method()
+void Doc_NB::set_method(SampleMethod _method, bool _auto_method)
 {
+    if (_method == method && _auto_method == auto_method)
+        return;
+
     size_t n = s->get_n();
 
     delete s;
 
-    s = new Sample_Table(n, d_now);
-    chisq->set_data(&d0, s);
+    method = _method;
+    auto_method = _auto_method;
+    s = make_sample(method, n, d_now);
+    s->set_generator(gen);
+    chisq->set_sample(s);
+
+    // Новый метод строит таблицы по текущей гипотезе.
+    sample_dirty = false;
+    p_value_ready = false;
 }
 
-void Doc_NB::set_bernulli_method()
+void Doc_NB::set_table_method()
 {
-    size_t n = s->get_n();
+    set_method(method_table, false);
+}
 
-    delete s;
+void Doc_NB::set_int_table_method()
+{
+    set_method(method_int_table, false);
+}
+
+void Doc_NB::set_bit_bernulli_method()
+{
+    set_method(method_bit_bernulli, false);
+}
+
+void Doc_NB::set_bernulli_method()
+{
+    set_method(method_bernulli, false);
+}
 
-    s = new Sample_Bernulli(n, d_now);
-    chisq->set_data(&d0, s);
+void Doc_NB::set_auto_method()
+{
+    set_method(sample_cost.fastest(d_now, s->get_n()), true);
 }
 
 void Doc_NB::set_hyp_d0()
 {
+    if (d_now == &d0)
+        return;
+
     d_now = &d0;
+    rebind();
+
+    if (d0 != d1)
+    {
+        sample_dirty = chipow_dirty = true;
+        p_value_ready = false;
+    }
 }
 
 void Doc_NB::set_hyp_d1()
 {
+    if (d_now == &d1)
+        return;
+
     d_now = &d1;
+    rebind();
+
+    if (d0 != d1)
+    {
+        sample_dirty = chipow_dirty = true;
+        p_value_ready = false;
+    }
 }
 
 Doc_NB::~Doc_NB()
@@ -542,6 +2853,10 @@ Doc_NB::~Doc_NB()
     if (p_value_arr)
         delete[] p_value_arr;
 
+    delete sketch;
+    delete gof;
+
     delete s;
     delete chisq;
+    delete chipow;
 }
\ No newline at end of file
@@ -18,8 +18,27 @@
 /// 
 /// @ref Sample_Bernulli - класс моделирования выборок методом Бернулли.
 ///
+/// @ref Sample_Table_Tail - класс моделирования выборок табличным методом с усечённой таблицей.
+///
+/// @ref Sample_Table_Int - класс моделирования выборок табличным методом по целым числам генератора.
+///
+/// @ref Sample_Bernulli_Bits - класс моделирования выборок методом Бернулли с побитовым моделированием испытаний.
+///
+/// @ref SampleCost - класс модели стоимости, по которой выбирается самый быстрый метод моделирования.
+///
+/// @ref Sample_Table_N - специализированный табличный метод при известном на этапе компиляции размере таблицы;
+/// выбирается функцией make_sample_table.
+///
+/// @ref Sample_Table_Fixed - табличный метод для фиксированных гипотез (Fixed_NB.h), таблицы которых вычислены при компиляции.
+///
 /// @ref ChiSqHist - класс критерия согласия \f$ \chi ^2 \f$.
 ///
+/// @ref GofPValues - класс выборок p-value дополнительных статистик согласия (G, Фримана-Тьюки, Колмогорова-Смирнова, Крамера-Мизеса).
+///
+/// @ref ChiSqPower - класс аналитической мощности критерия \f$ \chi ^2 \f$.
+///
+/// @ref PValueSketch - класс потокового эскиза выборки p-value.
+///
 /// @ref Doc_NB - класс моделирования выборок p-value.
 ///
 /// Пример использования классов:
@@ -34,17 +53,83 @@
 /// строить выборки из p-value.
 #pragma once
 
+#include <algorithm>
 #include <iostream>
 #include <random>
 #include <chrono>
+#include <string>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include "Fixed_NB.h"
+
+struct ResultHeader;
+class ResultCache;
 
 /// @brief Инициация генератора случайных чисел.
 extern unsigned int seed;
 /// @brief Генератор псевдослучайных чисел.
 extern std::default_random_engine generator;
 
+/// @brief Инициация потока генератора для повторения с номером i.
+/// @details Зависит только от seed и i, поэтому повторения можно моделировать в любом порядке и в разных потоках и процессах.
+/// @param[in] i Номер повторения.
+/// @return Значение для инициации генератора.
+uint64_t replicate_seed(uint64_t i);
+
+/// @brief Инициация потока генератора для блока с номером block большой выборки с номером stream.
+/// @details Зависит только от seed, stream и block (ChiSqHist::simulate_exp_freq_parallel).
+/// @param[in] stream Номер выборки.
+/// @param[in] block Номер блока.
+/// @return Значение для инициации генератора.
+uint64_t block_seed(uint64_t stream, uint64_t block);
+
+/// @brief Равномерное на [0, 1) случайное число.
+/// @details Совпадает с std::uniform_real_distribution<double>(0.0, 1.0), но не хранит состояния.
+/// @param[in, out] g Генератор случайных чисел.
+/// @return Случайное число.
+inline double uniform(std::default_random_engine& g)
+{
+    return std::generate_canonical<double, std::numeric_limits<double>::digits>(g);
+}
+
+/// @brief Размер буфера равномерных чисел, которые методы моделирования получают от генератора заранее.
+const size_t bulk_buffer = 256;
+
+/// @brief Наибольший размер таблицы, по которой значение ищется последовательным просмотром; по большим таблицам - двоичным поиском.
+const size_t linear_search_max = 64;
+
+/// @brief Поиск первого элемента таблицы суммированных вероятностей, не меньшего alpha.
+/// @param[in] table Таблица.
+/// @param[in] num Размер таблицы.
+/// @param[in] alpha Равномерное на [0, 1) случайное число.
+/// @return Номер элемента или num, если все элементы меньше alpha.
+inline size_t table_search(const double* table, size_t num, double alpha)
+{
+    if (num > linear_search_max)
+        return std::lower_bound(table, table + num, alpha) - table;
+
+    size_t j = 0;
+
+    while (j < num && table[j] < alpha)
+        ++j;
+
+    return j;
+}
+
+/// @brief Среднее значение распределения (средняя длина поиска по таблице), начиная с которого табличные методы получают
+/// частоты выборки проходом по упорядоченным равномерным числам, а не поиском значения каждого элемента.
+const double sorted_min_mean = 0.5;
+
+/// @brief Наибольшее количество значений в окне носителя распределения (размер таблиц методов моделирования и критериев).
+const size_t max_support = size_t(1) << 22;
+
 /// @brief Класс отрицательно-биномиального распределения.
 /// @details Класс, содержащий параметры отрицательно-биномиального распределения и вычисляющий его вероятности. 
+/// Вероятности вычисляются в окне носителя [lo, lo + num_states) - значениях, вероятности которых не пренебрежимо малы
+/// по сравнению с 1. Если вероятность нуля пренебрежимо мала (большие k или малые p), окно строится от моды, вероятность
+/// которой вычисляется через логарифм. Окно не шире max_support; вероятности значений за его пределами собираются
+/// в хвосты, которые таблицы относят к крайним значениям окна.
 class NB_distr
 {
 private:
@@ -56,6 +141,19 @@ private:
     size_t k;
     /// @brief Номер вычесленной вероятности.
     size_t culc_n;
+    /// @brief Первое значение окна носителя.
+    size_t lo;
+    /// @brief Количество значений в окне носителя.
+    size_t num_states;
+    /// @brief Вероятность значения lo.
+    double first_prob;
+    /// @brief Вероятность значений, меньших lo.
+    double lower_tail;
+    /// @brief Вероятность значений, не меньших lo + num_states.
+    double upper_tail;
+
+    /// @brief Вычисляет окно носителя и вероятности хвостов.
+    void make_support();
 public:
     /// @brief Конструктор по параметрам распределения: вероятности успеха и количества успехов.
     /// @param[in] _p Вероятность успеха.
@@ -82,13 +180,132 @@ public:
     /// @return Строку "Negative Binomial Distribution".
     const char* name_of_distr() const;
 
-    /// @brief Обнуляет вычисление вероятностей.
+    /// @brief Обнуляет вычисление вероятностей: текущей становится вероятность значения lo.
     void reset();
+
+    /// @brief Мода распределения.
+    /// @return Наиболее вероятное значение.
+    size_t mode() const;
+
+    /// @brief Логарифм вероятности значения, вычисляемый через логарифм гамма-функции без переполнения и потери порядка.
+    /// @param[in] x Значение.
+    /// @return Логарифм вероятности.
+    double log_pmf(size_t x) const;
+
+    /// @brief Доступ к первому значению окна носителя.
+    /// @return Первое значение окна.
+    inline size_t get_lo() const { return lo; }
+
+    /// @brief Доступ к размеру окна носителя.
+    /// @return Количество значений в окне.
+    inline size_t get_num_states() const { return num_states; }
+
+    /// @brief Доступ к вероятности значений, меньших первого значения окна.
+    /// @return Вероятность нижнего хвоста.
+    inline double get_lower_tail() const { return lower_tail; }
+
+    /// @brief Доступ к вероятности значений за последним значением окна.
+    /// @return Вероятность верхнего хвоста.
+    inline double get_upper_tail() const { return upper_tail; }
+
+    /// @brief Сравнение параметров распределений.
+    /// @param[in] d Распределение.
+    /// @return true, если вероятности успеха и количества успехов совпадают.
+    inline bool operator==(const NB_distr& d) const { return p == d.p && k == d.k; }
+
+    /// @brief Сравнение параметров распределений.
+    /// @param[in] d Распределение.
+    /// @return true, если параметры отличаются.
+    inline bool operator!=(const NB_distr& d) const { return !(*this == d); }
 };
 
+/// @brief Типизированное представление выборки.
+/// @tparam T Тип элементов выборки (uint8_t, uint16_t, uint32_t или uint64_t).
+template <class T>
+struct SampleView
+{
+    /// @brief Указатель на элементы выборки.
+    const T* data;
+    /// @brief Размер выборки.
+    size_t n;
+
+    /// @brief Доступ к элементам выборки по индексу.
+    /// @param[in] i Индекс элемента выборки.
+    /// @return Значение элемента выборки.
+    inline size_t operator[] (size_t i) const { return data[i]; }
+};
+
+/// @brief Номер состояния массива частот [first, first + num) для значения.
+/// @param[in] value Значение.
+/// @param[in] first Значение первого состояния.
+/// @param[in] num Количество состояний.
+/// @return Номер состояния; значения за пределами массива попадают в крайние состояния.
+inline size_t freq_state(size_t value, size_t first, size_t num)
+{
+    return value < first ? 0 : std::min(value - first, num - 1);
+}
+
+/// @brief Количество чередующихся вспомогательных гистограмм add_freq.
+const size_t freq_lanes = 4;
+/// @brief Наибольшее количество состояний, при котором add_freq считает частоты по вспомогательным гистограммам.
+const size_t freq_lanes_max = 1024;
+
+/// @brief Подсчитывает частоты значений выборки по состояниям [first, first + num) по одному значению.
+/// @param[in] v Выборка.
+/// @param[in, out] freq Массив частот.
+/// @param[in] num Количество состояний.
+/// @param[in] first Значение первого состояния.
+template <class T>
+void add_freq_serial(SampleView<T> v, size_t* freq, size_t num, size_t first)
+{
+    for (size_t i = 0; i < v.n; ++i)
+        ++freq[freq_state(v.data[i], first, num)];
+}
+
+/// @brief Подсчитывает частоты значений выборки по состояниям [first, first + num).
+/// @details Значения выборки по очереди распределяются между freq_lanes вспомогательными гистограммами с 32-битными счётчиками
+/// (значение i - в гистограмму i % freq_lanes), которые в конце складываются. Поэтому при немногих различных значениях
+/// соседние увеличения не ждут запись одного и того же счётчика. При большом количестве состояний или короткой выборке
+/// частоты считаются add_freq_serial.
+/// @param[in] v Выборка.
+/// @param[in, out] freq Массив частот.
+/// @param[in] num Количество состояний.
+/// @param[in] first Значение первого состояния.
+template <class T>
+void add_freq(SampleView<T> v, size_t* freq, size_t num, size_t first)
+{
+    if (num > freq_lanes_max || v.n < freq_lanes * num)
+        return add_freq_serial(v, freq, num, first);
+
+    uint32_t local[freq_lanes * freq_lanes_max];
+    // Блок не длиннее 2^32 - 1 значений, чтобы счётчики не переполнялись.
+    const size_t block = std::numeric_limits<uint32_t>::max(), last = first + num - 1;
+
+    for (size_t begin = 0; begin < v.n; begin += block)
+    {
+        size_t end = begin + std::min(block, v.n - begin), i = begin;
+
+        std::fill(local, local + freq_lanes * num, 0);
+
+        // То же, что freq_state, но без ветвления.
+        for (; i + freq_lanes <= end; i += freq_lanes)
+            for (size_t l = 0; l < freq_lanes; ++l)
+                ++local[l * num + std::min(std::max(size_t(v.data[i + l]), first), last) - first];
+
+        for (; i < end; ++i)
+            ++local[std::min(std::max(size_t(v.data[i]), first), last) - first];
+
+        for (size_t l = 0; l < freq_lanes; ++l)
+            for (size_t j = 0; j < num; ++j)
+                freq[j] += local[l * num + j];
+    }
+}
+
 /// @brief Класс моделирования распределений.
 /// @details Базовый класс для моделирования распределений, содержащий размер выборки, указатель на распределение и массив выборки.
 /// Позволяет генерировать выборку, изменять её размер и получать её параметры и название метода.
+/// Элементы выборки хранятся числами наименьшей подходящей ширины (1, 2, 4 или 8 байт): ширина выбирается по носителю
+/// распределения, если он известен, и увеличивается, когда смоделированное значение в неё не помещается.
 class Sample
 {
 protected:
@@ -96,12 +313,32 @@ protected:
     size_t n;
     /// @brief Указатель на класс распределения.
     NB_distr* d;
-    /// @brief Массив с выборкой.
-    size_t* sam;
+    /// @brief Массив с выборкой (создаётся при первом моделировании).
+    unsigned char* sam;
+    /// @brief Ширина элемента выборки в байтах.
+    size_t width;
+    /// @brief Указатель на генератор случайных чисел (по умолчанию - глобальный generator, у копии - own_gen).
+    std::default_random_engine* gen;
+    /// @brief Собственный генератор копии.
+    std::default_random_engine own_gen;
 
     /// @brief Осуществляет обмен полями между объектом класса и переданным s.
     /// @param s Объект класса Sample.
     void swap(Sample& s);
+
+    /// @brief Создаёт массив выборки, если он ещё не создан.
+    void allocate();
+
+    /// @brief Увеличивает ширину элементов выборки так, чтобы в неё помещалось значение max_value.
+    /// @param[in] max_value Наибольшее значение.
+    /// @param[in] filled Количество уже записанных элементов, которые нужно сохранить.
+    void reserve_width(size_t max_value, size_t filled = 0);
+
+    /// @brief Записывает значение в элементы выборки [begin, end).
+    /// @param[in] begin Индекс первого элемента.
+    /// @param[in] end Индекс после последнего элемента.
+    /// @param[in] value Значение, помещающееся в ширину элементов.
+    void fill_value(size_t begin, size_t end, size_t value);
 public:
     /// @brief Конструктор модирования распределений по размеру выборки и распределению.
     /// @param[in] _n Размер выборки.
@@ -109,6 +346,8 @@ public:
     Sample(size_t _n, NB_distr* _d);
 
     /// @brief Конструктор копирования.
+    /// @details Выборка не копируется: массив копии создаётся при её первом моделировании. Копия моделирует собственным
+    /// генератором, инициированным состоянием генератора s, поэтому копии в разных потоках не используют общий генератор.
     /// @param[in] s Объект класса Sample.
     Sample(const Sample& s);
 
@@ -127,19 +366,74 @@ public:
     /// @brief Симулирует выборку, записывая её во внутренний массив.
     void simulate();
 
+    /// @brief Симулирует выборку и добавляет частоты её значений к массиву частот.
+    /// @details По умолчанию выборка моделируется simulate и затем подсчитывается. Методы, которые получают частоты
+    /// сразу, без поиска значения каждого элемента, переопределяют функцию; выборка при этом тоже записывается во внутренний массив.
+    /// @param[in, out] freq Массив частот.
+    /// @param[in] num Размер массива частот.
+    /// @param[in] first Значение первого состояния (значения вне [first, first + num) попадают в крайние состояния).
+    virtual void simulate_freq(size_t* freq, size_t num, size_t first = 0);
+
+    /// @brief Добавляет частоты значений выборки к массиву частот (ничего не добавляет, если выборка ещё не смоделирована).
+    /// @param[in, out] freq Массив частот.
+    /// @param[in] num Размер массива частот.
+    /// @param[in] first Значение первого состояния (значения вне [first, first + num) попадают в крайние состояния).
+    void count_freq(size_t* freq, size_t num, size_t first = 0) const;
+
     /// @brief Симулирует один элемент выборки.
     /// @return Значение элемента выборки.
     virtual size_t simulate_one() = 0;
 
+    /// @brief Создаёт копию метода моделирования того же типа.
+    /// @details Таблицы метода неизменяемы и разделяются с копией; выборка и генератор у копии собственные (см. конструктор копирования).
+    /// @return Указатель на копию (освобождается вызывающим).
+    virtual Sample* clone() const = 0;
+
+    /// @brief Симулирует count элементов выборки.
+    /// @details Обращается к генератору в том же порядке, что и count вызовов simulate_one, поэтому результаты совпадают.
+    /// @param[out] out Массив для элементов выборки размера не меньше count.
+    /// @param[in] count Количество элементов.
+    /// @param[in, out] rng Генератор случайных чисел.
+    virtual void simulate_bulk(size_t* out, size_t count, std::default_random_engine& rng) = 0;
+
     /// @brief Изменяет размер выборки.
+    /// @details Таблицы метода от размера выборки не зависят и не перестраиваются.
     /// @param[in] _n Размер выборки.
     void change_param(size_t _n);
 
+    /// @brief Перестраивает таблицы метода после изменения параметров распределения d.
+    /// @details Методы без таблиц ничего не делают.
+    virtual void rebuild() {}
+
+    /// @brief Изменяет генератор случайных чисел, например, чтобы моделировать в нескольких потоках.
+    /// @param[in] _gen Указатель на генератор.
+    void set_generator(std::default_random_engine* _gen);
+
+    /// @brief Перенаправляет метод на другой объект распределения с теми же параметрами, не перестраивая таблицы.
+    /// @param[in] _d Указатель на распределение.
+    void rebind(NB_distr* _d);
+
     /// @brief Доступ к элементам выборки по индексу.
     /// @param[in] i Индекс элемента выборки.
-    /// @return Значение элемента выборки. 
+    /// @return Значение элемента выборки (0, если выборка ещё не смоделирована).
     size_t operator[] (int i) const;
 
+    /// @brief Доступ к ширине элемента выборки.
+    /// @return Ширина элемента в байтах (1, 2, 4 или 8).
+    inline size_t get_width() const { return width; }
+
+    /// @brief Типизированное представление выборки.
+    /// @tparam T Тип элементов, размер которого равен get_width().
+    /// @return Представление выборки.
+    template <class T>
+    SampleView<T> view() const
+    {
+        if (sizeof(T) != width)
+            throw "Sample::view: Type does not match sample width.";
+
+        return SampleView<T>{(const T*)sam, n};
+    }
+
     /// @brief Деструктор Sample.
     virtual ~Sample() = 0;
 };
@@ -150,17 +444,13 @@ public:
 /// Позволяет генерировать выборку, изменять её размер и получать её параметры и название метода.
 class Sample_Table : public Sample
 {
-private:
-    /// @brief Массив суммированных вероятностей.
-    double* sum_distr;
+protected:
+    /// @brief Массив суммированных вероятностей (неизменяемый, разделяется между копиями).
+    std::shared_ptr<const double> sum_distr;
     /// @brief Размер массива суммированных вероятностей.
     size_t num_sum_distr;
 
-    /// @brief Вычисляет размер массива суммированных вероятностей до значений вероятностей, равных машинному нулю.
-    /// @param d Указатель на распределение.
-    /// @return Размер массива суммированных вероятностей.
-    size_t max_num(NB_distr* d) const;
-
+private:
     /// @brief Создаёт таблицу для метода (массив суммированных вероятностей).
     void make_sum_distr();
 
@@ -173,6 +463,11 @@ public:
     /// @param[in] _d Указатель на распределение.
     Sample_Table(size_t _n, NB_distr* _d);
 
+    /// @brief Вычисляет размер массива суммированных вероятностей до значений вероятностей, равных машинному нулю.
+    /// @param d Указатель на распределение.
+    /// @return Размер массива суммированных вероятностей.
+    static size_t max_num(NB_distr* d);
+
     /// @brief Конструктор копирования.
     /// @param[in] s Объект класса Sample_Table.
     Sample_Table(const Sample_Table& s);
@@ -190,16 +485,31 @@ public:
     /// @return Константную строку "Table Method".
     virtual const char* get_name() const override;
 
-    /// @brief Изменяет размер выборки.
-    /// @param[in] _n Размер выборки.
-    void change_param(size_t _n);
+    /// @brief Перестраивает таблицу после изменения параметров распределения.
+    virtual void rebuild() override;
 
     /// @brief Симулирует один элемент выборки.
     /// @return Значение элемента выборки.
     virtual size_t simulate_one() override;
 
-    /// @brief Деструктор Sample_Table.
-    ~Sample_Table();
+    /// @brief Симулирует count элементов выборки, получая равномерные числа от генератора блоками по bulk_buffer.
+    /// @param[out] out Массив для элементов выборки размера не меньше count.
+    /// @param[in] count Количество элементов.
+    /// @param[in, out] rng Генератор случайных чисел.
+    virtual void simulate_bulk(size_t* out, size_t count, std::default_random_engine& rng) override;
+
+    /// @brief Симулирует выборку и добавляет частоты её значений к массиву частот одним проходом по таблице.
+    /// @details Если поиск значения одного элемента в среднем длиннее sorted_min_mean шагов, n равномерных чисел
+    /// моделируются сразу упорядоченными (через нормированные суммы экспоненциальных интервалов) и разносятся по значениям
+    /// одним проходом по таблице за O(n + K) вместо n поисков от начала таблицы. Выборка записывается упорядоченной по возрастанию.
+    /// @param[in, out] freq Массив частот.
+    /// @param[in] num Размер массива частот.
+    /// @param[in] first Значение первого состояния (значения вне [first, first + num) попадают в крайние состояния).
+    virtual void simulate_freq(size_t* freq, size_t num, size_t first = 0) override;
+
+    /// @brief Создаёт копию метода моделирования, разделяющую с ним таблицу.
+    /// @return Указатель на копию (освобождается вызывающим).
+    virtual Sample* clone() const override;
 };
 
 /// @brief Класс моделирования распределения методом Бернулли.
@@ -208,6 +518,41 @@ public:
 /// Позволяет генерировать выборку, изменять её размер и получать её параметры и название метода.
 class Sample_Bernulli : public Sample
 {
+private:
+    /// @brief Симулирует count элементов выборки с k успехами и вероятностью успеха p.
+    /// @details Каждый элемент требует не меньше k равномерных чисел, поэтому буфер заполняется не больше чем
+    /// на оставшуюся нижнюю границу их количества, и лишние числа у генератора не забираются.
+    /// @param[out] out Массив для элементов выборки размера не меньше count.
+    /// @param[in] count Количество элементов.
+    /// @param[in, out] rng Генератор случайных чисел.
+    /// @param[in] k Количество успехов.
+    /// @param[in] p Вероятность успеха.
+    static inline void bulk(size_t* out, size_t count, std::default_random_engine& rng, size_t k, double p)
+    {
+        double buff[bulk_buffer];
+        size_t pos = 0, num = 0;
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            size_t l = 0, j = 0;
+
+            while (l != k)
+            {
+                if (pos == num)
+                {
+                    num = std::min(bulk_buffer, (k - l) + (count - i - 1) * k);
+                    pos = 0;
+
+                    for (size_t t = 0; t < num; ++t)
+                        buff[t] = uniform(rng);
+                }
+
+                buff[pos++] > p ? ++j : ++l;
+            }
+
+            out[i] = j;
+        }
+    }
 public:
     /// @brief Конструктор модирования распределений методом Бернулли по размеру выборки и распределению.
     /// @param[in] _n Размер выборки.
@@ -234,8 +579,475 @@ public:
     /// @brief Симулирует один элемент выборки.
     /// @return Значение элемента выборки.
     virtual size_t simulate_one() override;
+
+    /// @brief Симулирует count элементов выборки.
+    /// @param[out] out Массив для элементов выборки размера не меньше count.
+    /// @param[in] count Количество элементов.
+    /// @param[in, out] rng Генератор случайных чисел.
+    virtual void simulate_bulk(size_t* out, size_t count, std::default_random_engine& rng) override;
+
+    /// @brief Создаёт копию метода моделирования.
+    /// @return Указатель на копию (освобождается вызывающим).
+    virtual Sample* clone() const override;
+};
+
+/// @brief Класс моделирования распределения табличным методом с таблицей фиксированного размера.
+/// @details Таблица хранится внутри объекта, а за последним значением записываются ограничители, большие 1,
+/// поэтому поиск не проверяет выход за границу таблицы. Выборки совпадают с Sample_Table.
+/// Если таблица распределения не помещается в N - 1 элементов, используется общий метод.
+/// @tparam N Размер таблицы.
+template <size_t N>
+class Sample_Table_N : public Sample_Table
+{
+private:
+    /// @brief Массив суммированных вероятностей с ограничителями.
+    double fixed_distr[N];
+
+    /// @brief Копирует таблицу в массив фиксированного размера.
+    void make_fixed_distr()
+    {
+        if (num_sum_distr >= N)
+            return;
+
+        for (size_t i = 0; i < num_sum_distr; ++i)
+            fixed_distr[i] = sum_distr.get()[i];
+
+        for (size_t i = num_sum_distr; i < N; ++i)
+            fixed_distr[i] = 2;
+    }
+
+    /// @brief Поиск значения по таблице.
+    /// @param[in] alpha Равномерное на [0, 1) случайное число.
+    /// @return Значение элемента выборки.
+    inline size_t find(double alpha) const
+    {
+        size_t j = 0;
+
+        while (fixed_distr[j] < alpha)
+            ++j;
+
+        return j;
+    }
+public:
+    /// @brief Конструктор модирования распределений табличным методом по размеру выборки и распределению.
+    /// @param[in] _n Размер выборки.
+    /// @param[in] _d Указатель на распределение.
+    Sample_Table_N(size_t _n, NB_distr* _d) : Sample_Table(_n, _d) { make_fixed_distr(); }
+
+    /// @brief Создаёт копию метода моделирования.
+    /// @return Указатель на копию (освобождается вызывающим).
+    virtual Sample* clone() const override { return new Sample_Table_N<N>(*this); }
+
+    /// @brief Перестраивает таблицу после изменения параметров распределения.
+    virtual void rebuild() override
+    {
+        Sample_Table::rebuild();
+        make_fixed_distr();
+    }
+
+    /// @brief Симулирует count элементов выборки, получая равномерные числа от генератора блоками по bulk_buffer.
+    /// @param[out] out Массив для элементов выборки размера не меньше count.
+    /// @param[in] count Количество элементов.
+    /// @param[in, out] rng Генератор случайных чисел.
+    virtual void simulate_bulk(size_t* out, size_t count, std::default_random_engine& rng) override
+    {
+        if (num_sum_distr >= N)
+        {
+            Sample_Table::simulate_bulk(out, count, rng);
+
+            return;
+        }
+
+        double buff[bulk_buffer];
+
+        for (size_t i = 0; i < count; i += bulk_buffer)
+        {
+            size_t num = std::min(bulk_buffer, count - i);
+
+            for (size_t t = 0; t < num; ++t)
+                buff[t] = uniform(rng);
+
+            for (size_t t = 0; t < num; ++t)
+                out[i + t] = d->get_lo() + find(buff[t]);
+        }
+    }
+
+    /// @brief Симулирует один элемент выборки.
+    /// @return Значение элемента выборки.
+    virtual size_t simulate_one() override
+    {
+        return num_sum_distr < N ? d->get_lo() + find(uniform(*gen)) : Sample_Table::simulate_one();
+    }
+};
+
+/// @brief Класс моделирования распределения табличным методом для фиксированной гипотезы.
+/// @details Таблица суммированных вероятностей вычислена на этапе компиляции (FixedNB), её размер известен компилятору,
+/// поэтому поиск не обращается к полям объекта. Выборки совпадают с Sample_Table.
+/// Если параметры распределения отличаются от гипотезы I, используется общий метод.
+/// @tparam I Номер гипотезы в fixed_configs.
+template <size_t I>
+class Sample_Table_Fixed : public Sample_Table
+{
+private:
+    /// @brief Совпадают ли параметры распределения с гипотезой I.
+    /// @return true, если совпадают.
+    inline bool is_fixed() const { return d->get_p() == FixedNB<I>::p && d->get_k() == FixedNB<I>::k; }
+
+    /// @brief Поиск значения по таблице.
+    /// @param[in] alpha Равномерное на [0, 1) случайное число.
+    /// @return Значение элемента выборки.
+    static inline size_t find(double alpha)
+    {
+        size_t j = 0;
+
+        while (j < FixedNB<I>::num && FixedNB<I>::table.sum[j] < alpha)
+            ++j;
+
+        return j;
+    }
+public:
+    /// @brief Конструктор модирования распределений табличным методом по размеру выборки и распределению.
+    /// @param[in] _n Размер выборки.
+    /// @param[in] _d Указатель на распределение.
+    Sample_Table_Fixed(size_t _n, NB_distr* _d) : Sample_Table(_n, _d) {}
+
+    /// @brief Создаёт копию метода моделирования.
+    /// @return Указатель на копию (освобождается вызывающим).
+    virtual Sample* clone() const override { return new Sample_Table_Fixed<I>(*this); }
+
+    /// @brief Симулирует count элементов выборки, получая равномерные числа от генератора блоками по bulk_buffer.
+    /// @param[out] out Массив для элементов выборки размера не меньше count.
+    /// @param[in] count Количество элементов.
+    /// @param[in, out] rng Генератор случайных чисел.
+    virtual void simulate_bulk(size_t* out, size_t count, std::default_random_engine& rng) override
+    {
+        if (!is_fixed())
+        {
+            Sample_Table::simulate_bulk(out, count, rng);
+
+            return;
+        }
+
+        double buff[bulk_buffer];
+
+        for (size_t i = 0; i < count; i += bulk_buffer)
+        {
+            size_t num = std::min(bulk_buffer, count - i);
+
+            for (size_t t = 0; t < num; ++t)
+                buff[t] = uniform(rng);
+
+            for (size_t t = 0; t < num; ++t)
+                out[i + t] = find(buff[t]);
+        }
+    }
+
+    /// @brief Симулирует один элемент выборки.
+    /// @return Значение элемента выборки.
+    virtual size_t simulate_one() override
+    {
+        return is_fixed() ? find(uniform(*gen)) : Sample_Table::simulate_one();
+    }
+};
+
+/// @brief Вероятность хвоста распределения, не покрываемого усечённой таблицей.
+const double table_tail = 1e-6;
+
+/// @brief Класс моделирования распределения табличным методом с усечённой таблицей.
+/// @details Таблица суммированных вероятностей строится только до квантиля уровня 1 - tail, поэтому при малых p
+/// остаётся небольшой и помещается в кэш. Если равномерное число больше последнего значения таблицы, поиск продолжается
+/// вычислением следующих вероятностей по той же рекуррентной формуле и в том же порядке, что и при построении полной таблицы
+/// Sample_Table, поэтому выборки совпадают с Sample_Table (и распределение остаётся точным).
+class Sample_Table_Tail : public Sample
+{
+private:
+    /// @brief Массив суммированных вероятностей до квантиля 1 - tail с ограничителем, большим 1, в конце
+    /// (неизменяемый, разделяется между копиями).
+    std::shared_ptr<const double> sum_distr;
+    /// @brief Размер усечённой таблицы.
+    size_t num_sum_distr;
+    /// @brief Размер полной таблицы Sample_Table (граница поиска в хвосте).
+    size_t num_full;
+    /// @brief Вероятность последнего значения таблицы.
+    double last_prob;
+    /// @brief Вероятность хвоста, не покрываемого таблицей.
+    double tail;
+
+    /// @brief Создаёт усечённую таблицу.
+    void make_sum_distr();
+
+    /// @brief Поиск значения по таблице и, если нужно, в хвосте.
+    /// @param[in] table Таблица суммированных вероятностей.
+    /// @param[in] alpha Равномерное на [0, 1) случайное число.
+    /// @return Значение элемента выборки.
+    inline size_t find(const double* table, double alpha) const
+    {
+        size_t j = table_search(table, num_sum_distr + 1, alpha);
+
+        return j < num_sum_distr || j >= num_full ? j : find_tail(alpha);
+    }
+
+    /// @brief Поиск значения в хвосте за пределами таблицы.
+    /// @param[in] alpha Равномерное число, большее последнего значения таблицы.
+    /// @return Значение элемента выборки.
+    size_t find_tail(double alpha) const;
+public:
+    /// @brief Конструктор модирования распределений табличным методом с усечённой таблицей.
+    /// @param[in] _n Размер выборки.
+    /// @param[in] _d Указатель на распределение.
+    /// @param[in] _tail Вероятность хвоста, не покрываемого таблицей.
+    Sample_Table_Tail(size_t _n, NB_distr* _d, double _tail = table_tail);
+
+    /// @brief Доступ к размеру усечённой таблицы.
+    /// @return Количество элементов таблицы.
+    inline size_t get_num_sum_distr() const { return num_sum_distr; }
+
+    /// @brief Доступ к названию методу моделирования.
+    /// @return Константную строку "Table Method".
+    virtual const char* get_name() const override;
+
+    /// @brief Перестраивает таблицу после изменения параметров распределения.
+    virtual void rebuild() override;
+
+    /// @brief Симулирует один элемент выборки.
+    /// @return Значение элемента выборки.
+    virtual size_t simulate_one() override;
+
+    /// @brief Симулирует count элементов выборки, получая равномерные числа от генератора блоками по bulk_buffer.
+    /// @param[out] out Массив для элементов выборки размера не меньше count.
+    /// @param[in] count Количество элементов.
+    /// @param[in, out] rng Генератор случайных чисел.
+    virtual void simulate_bulk(size_t* out, size_t count, std::default_random_engine& rng) override;
+
+    /// @brief Симулирует выборку и добавляет частоты её значений к массиву частот одним проходом по таблице (как Sample_Table).
+    /// @details Упорядоченные равномерные числа за пределами усечённой таблицы ищутся в хвосте по одному.
+    /// @param[in, out] freq Массив частот.
+    /// @param[in] num Размер массива частот.
+    /// @param[in] first Значение первого состояния (значения вне [first, first + num) попадают в крайние состояния).
+    virtual void simulate_freq(size_t* freq, size_t num, size_t first = 0) override;
+
+    /// @brief Создаёт копию метода моделирования, разделяющую с ним таблицу.
+    /// @return Указатель на копию (освобождается вызывающим).
+    virtual Sample* clone() const override;
+};
+
+/// @brief Класс моделирования распределения табличным методом по целым числам генератора.
+/// @details Два значения генератора объединяются в целое число S, равномерно распределённое на [0, R^2), где R - количество
+/// значений генератора; функция распределения хранится целыми порогами \f$ T_j = [F(j) R^2] \f$, и возвращается первое j с \f$ S < T_j \f$.
+/// В отличие от Sample_Table, нет перевода в double и деления: вероятность каждого значения равна \f$ (T_j - T_{j-1}) / R^2 \f$
+/// точно (ошибка порогов меньше \f$ 1 / R^2 \f$), равномерное число не может округлиться до 1, а последний порог равен \f$ R^2 \f$,
+/// поэтому значения за пределами таблицы не появляются.
+class Sample_Table_Int : public Sample
+{
+private:
+    /// @brief Пороги функции распределения (неизменяемые, разделяются между копиями).
+    std::shared_ptr<const uint64_t> thresholds;
+    /// @brief Количество порогов.
+    size_t num_thresholds;
+
+    /// @brief Создаёт таблицу порогов.
+    void make_thresholds();
+
+    /// @brief Количество значений генератора.
+    static constexpr uint64_t range = uint64_t(std::default_random_engine::max() - std::default_random_engine::min()) + 1;
+    static_assert(range <= (uint64_t(1) << 32), "Sample_Table_Int: generator range must fit in 32 bits.");
+
+    /// @brief Равномерное на [0, R^2) целое число из двух значений генератора (в том же порядке, что в std::generate_canonical).
+    /// @param[in, out] g Генератор случайных чисел.
+    /// @return Случайное число.
+    static inline uint64_t draw(std::default_random_engine& g)
+    {
+        uint64_t low = g() - std::default_random_engine::min();
+
+        return low + (g() - std::default_random_engine::min()) * range;
+    }
+
+    /// @brief Поиск значения по таблице порогов.
+    /// @param[in] table Пороги.
+    /// @param[in] x Равномерное на [0, R^2) целое число.
+    /// @return Значение элемента выборки.
+    inline size_t find(const uint64_t* table, uint64_t x) const
+    {
+        if (num_thresholds > linear_search_max)
+            return std::upper_bound(table, table + num_thresholds - 1, x) - table;
+
+        size_t j = 0;
+
+        // При R < 2^32 число x меньше последнего порога UINT64_MAX, и проверка границы не нужна.
+        while ((range < (uint64_t(1) << 32) || j + 1 < num_thresholds) && table[j] <= x)
+            ++j;
+
+        return j;
+    }
+public:
+    /// @brief Конструктор модирования распределений табличным методом по размеру выборки и распределению.
+    /// @param[in] _n Размер выборки.
+    /// @param[in] _d Указатель на распределение.
+    Sample_Table_Int(size_t _n, NB_distr* _d);
+
+    /// @brief Доступ к названию методу моделирования.
+    /// @return Константную строку "Integer Table Method".
+    virtual const char* get_name() const override;
+
+    /// @brief Перестраивает таблицу после изменения параметров распределения.
+    virtual void rebuild() override;
+
+    /// @brief Симулирует один элемент выборки.
+    /// @return Значение элемента выборки.
+    virtual size_t simulate_one() override;
+
+    /// @brief Симулирует count элементов выборки.
+    /// @param[out] out Массив для элементов выборки размера не меньше count.
+    /// @param[in] count Количество элементов.
+    /// @param[in, out] rng Генератор случайных чисел.
+    virtual void simulate_bulk(size_t* out, size_t count, std::default_random_engine& rng) override;
+
+    /// @brief Создаёт копию метода моделирования, разделяющую с ним таблицу.
+    /// @return Указатель на копию (освобождается вызывающим).
+    virtual Sample* clone() const override;
+};
+
+/// @brief Класс моделирования распределения методом Бернулли с побитовым моделированием испытаний.
+/// @details Испытание успешно, если равномерное число U меньше p. Вместо числа double на каждое испытание 64 испытания
+/// моделируются одновременно: i-й бит очередного случайного слова - очередной двоичный разряд U для i-го испытания,
+/// и разряды сравниваются с двоичным разложением p, пока все испытания не решены (в среднем около 7 слов на 64 испытания).
+/// Сравнение точное для 64 двоичных разрядов p, то есть для любого p не меньше \f$ 2^{-11} \f$ вероятность успеха равна p в точности.
+/// Успехи и неудачи затем считаются по маске успехов инструкциями popcount и поиска младшего бита. Неиспользованные испытания
+/// маски переходят к следующему элементу выборки и отбрасываются в конце simulate_bulk.
+/// Распределение выборки совпадает с Sample_Bernulli, но генератор используется иначе, поэтому выборки не совпадают.
+class Sample_Bernulli_Bits : public Sample
+{
+private:
+    /// @brief Маска успехов 64 испытаний.
+    /// @param[in, out] g Генератор случайных чисел.
+    /// @param[in] p_bits Вероятность успеха в виде 64-разрядной двоичной дроби.
+    /// @return Маска, в которой i-й бит равен 1, если i-е испытание успешно.
+    static uint64_t success_mask(std::default_random_engine& g, uint64_t p_bits);
+public:
+    /// @brief Конструктор модирования распределений методом Бернулли по размеру выборки и распределению.
+    /// @param[in] _n Размер выборки.
+    /// @param[in] _d Указатель на распределение.
+    Sample_Bernulli_Bits(size_t _n, NB_distr* _d);
+
+    /// @brief Доступ к названию методу моделирования.
+    /// @return Константную строку "Bit Bernulli Method".
+    virtual const char* get_name() const override;
+
+    /// @brief Симулирует один элемент выборки.
+    /// @return Значение элемента выборки.
+    virtual size_t simulate_one() override;
+
+    /// @brief Симулирует count элементов выборки.
+    /// @param[out] out Массив для элементов выборки размера не меньше count.
+    /// @param[in] count Количество элементов.
+    /// @param[in, out] rng Генератор случайных чисел.
+    virtual void simulate_bulk(size_t* out, size_t count, std::default_random_engine& rng) override;
+
+    /// @brief Создаёт копию метода моделирования.
+    /// @return Указатель на копию (освобождается вызывающим).
+    virtual Sample* clone() const override;
+};
+
+/// @brief Создаёт табличный метод моделирования: для фиксированной гипотезы - Sample_Table_Fixed, иначе с таблицей
+/// наименьшего подходящего фиксированного размера, если она не больше 256, иначе - с усечённой таблицей.
+/// @param[in] n Размер выборки.
+/// @param[in] d Указатель на распределение.
+/// @return Указатель на созданный метод моделирования (освобождается вызывающим).
+Sample* make_sample_table(size_t n, NB_distr* d);
+
+/// @brief Методы моделирования, из которых выбирает автоматический метод.
+enum SampleMethod
+{
+    /// @brief Метод Бернулли (Sample_Bernulli).
+    method_bernulli,
+    /// @brief Метод Бернулли с побитовым моделированием испытаний (Sample_Bernulli_Bits).
+    method_bit_bernulli,
+    /// @brief Табличный метод (make_sample_table).
+    method_table,
+    /// @brief Табличный метод по целым числам генератора (Sample_Table_Int).
+    method_int_table,
+    /// @brief Количество методов.
+    num_sample_methods
+};
+
+/// @brief Создаёт метод моделирования.
+/// @param[in] method Метод моделирования.
+/// @param[in] n Размер выборки.
+/// @param[in] d Указатель на распределение.
+/// @return Указатель на созданный метод моделирования (освобождается вызывающим).
+Sample* make_sample(SampleMethod method, size_t n, NB_distr* d);
+
+/// @brief Класс модели стоимости методов моделирования.
+/// @details Время моделирования выборки (вместе с подсчётом частот) методом m приближается как \f$ n (a_m + b_m x_m) \f$, где
+/// \f$ x_m \f$ - работа на один элемент: k/p испытаний для методов Бернулли, k(1 - p)/p шагов поиска для табличного метода
+/// по целым числам и k(1 - p)/(pn) для табличного метода, который проходит таблицу один раз на выборку. Коэффициенты по умолчанию
+/// получены на типичной машине, calibrate измеряет их заново по нескольким коротким моделированиям.
+class SampleCost
+{
+private:
+    /// @brief Время элемента выборки без учёта работы, нс.
+    double a[num_sample_methods];
+    /// @brief Время единицы работы, нс.
+    double b[num_sample_methods];
+public:
+    /// @brief Конструктор модели с коэффициентами по умолчанию.
+    SampleCost();
+
+    /// @brief Работа метода на один элемент выборки.
+    /// @param[in] method Метод моделирования.
+    /// @param[in] d Указатель на распределение.
+    /// @param[in] n Размер выборки.
+    /// @return Количество единиц работы на элемент.
+    static double work(SampleMethod method, const NB_distr* d, size_t n);
+
+    /// @brief Измеряет коэффициенты модели на текущей машине.
+    /// @details Каждый метод моделирует выборки двух распределений с разной работой на элемент не меньше budget секунд
+    /// на распределение, по собственному генератору (глобальный generator не изменяется).
+    /// @param[in] budget Время измерения одного распределения одним методом, с.
+    void calibrate(double budget = 0.002);
+
+    /// @brief Оценка времени моделирования выборки.
+    /// @param[in] method Метод моделирования.
+    /// @param[in] d Указатель на распределение.
+    /// @param[in] n Размер выборки.
+    /// @return Время моделирования выборки, нс.
+    double cost(SampleMethod method, const NB_distr* d, size_t n) const;
+
+    /// @brief Выбор самого быстрого метода.
+    /// @param[in] d Указатель на распределение.
+    /// @param[in] n Размер выборки.
+    /// @return Метод с наименьшей оценкой времени.
+    SampleMethod fastest(const NB_distr* d, size_t n) const;
+};
+
+/// @brief Модель стоимости, по которой выбирает автоматический метод моделирования.
+extern SampleCost sample_cost;
+
+/// @brief Статистики согласия, которые ChiSqHist вычисляет по одной таблице частот.
+enum GofStat
+{
+    /// @brief \f$ \chi ^2 \f$ Пирсона: \f$ \sum (O - E)^2 / E \f$.
+    stat_pearson,
+    /// @brief Отношение правдоподобия (G-критерий): \f$ 2 \sum O \ln (O / E) \f$.
+    stat_g,
+    /// @brief Статистика Фримана-Тьюки: \f$ 4 \sum (\sqrt O - \sqrt E)^2 \f$.
+    stat_freeman_tukey,
+    /// @brief Статистика Колмогорова-Смирнова для дискретного распределения: \f$ \sqrt n \max_j |F_n(j) - F(j)| \f$.
+    stat_ks,
+    /// @brief Статистика Крамера-Мизеса для дискретного распределения: \f$ n \sum_j (F_n(j) - F(j))^2 p_j \f$.
+    stat_cvm,
+    /// @brief Количество статистик.
+    num_gof_stats
 };
 
+/// @brief Название статистики согласия.
+/// @param[in] stat Статистика.
+/// @return Константную строку с названием.
+const char* gof_stat_name(GofStat stat);
+
+/// @brief Размер блока большой выборки, моделируемого одним потоком (ChiSqHist::simulate_exp_freq_parallel).
+const size_t parallel_block = size_t(1) << 16;
+
 /// @brief Класс критерия согласия.
 /// @details Класс, который хранит вычисленные теоретические и эмперические вероятности распределения и выборки, вычисляет критерий \f$ \chi ^2 \f$ 
 /// и значение p-value. Позволяет сменить распределение и метод моделирования.
@@ -257,20 +1069,36 @@ private:
     size_t num_freq;
     /// @brief Массив эмперических частот.
     size_t* exp_freq;
-    /// @brief Теоретические вероятности.
-    double* th_freq;
-
-    /// @brief Объединяет состояния, чтобы критерий был применим.
-    /// @param[in, out] exp_freq_merge Массив эмперических частот для объединения.
-    /// @param[in, out] th_freq_merge Массив теоретических вероятностей для объединения.
-    /// @return Размер объединённых массивов.
-    size_t merge(size_t* exp_freq_merge, double* th_freq_merge);
-    /// @brief Вычисляет значение критерия \f$ \chi ^2 \f$.
-    /// @param[in] new_num Размер объединённых массивов.
-    /// @param[in] exp_freq_merge Объединённый массив эмперических частот.
-    /// @param[in] th_freq_merge Объединённый массив теоретических вероятностей.
+    /// @brief Размер выборки, по которой составлена таблица эмперических частот.
+    size_t freq_n;
+    /// @brief Теоретические вероятности (неизменяемые, разделяются между копиями).
+    std::shared_ptr<const double> th_freq;
+
+    /// @brief Размер выборки, для которого построен план объединения (0, если план не построен).
+    size_t plan_n;
+    /// @brief Количество объединённых состояний.
+    size_t num_merge;
+    /// @brief План объединения: номер объединённого состояния для каждого состояния (неизменяемый, разделяется между копиями).
+    std::shared_ptr<const size_t> merge_inx;
+    /// @brief Объединённые теоретические вероятности (неизменяемые, разделяются между копиями).
+    std::shared_ptr<const double> th_merge;
+    /// @brief Объединённые эмперические частоты.
+    size_t* exp_merge;
+
+    /// @brief Вычисляются ли все статистики GofStat (иначе - только \f$ \chi ^2 \f$ Пирсона).
+    bool all_stats;
+    /// @brief Значения статистик согласия.
+    double stat[num_gof_stats];
+    /// @brief p-value статистик согласия.
+    double stat_p_value[num_gof_stats];
+
+    /// @brief Строит план объединения состояний для текущего размера выборки.
+    void make_merge_plan();
+    /// @brief Вычисляет значение критерия \f$ \chi ^2 \f$ по объединённым частотам.
     /// @return Значение критерия для данной выборки.
-    double chi_square(size_t new_num, size_t* exp_freq_merge, double* th_freq_merge);
+    double chi_square();
+    /// @brief Вычисляет все статистики согласия одним проходом по частотам и одним - по объединённым частотам.
+    void calc_all_stats();
 
     /// @brief Осуществляет обмен полями между объектом класса и переданным c.
     /// @param[in, out] c Объект класса ChiSqHist.
@@ -283,7 +1111,7 @@ public:
 
     /// @brief Конструктор копирования.
     /// @param[in] c Объект класса ChiSqHist.
-    ChiSqHist(ChiSqHist& c);
+    ChiSqHist(const ChiSqHist& c);
 
     /// @brief Конструктор перемещения.
     /// @param[in] c Объект класса ChiSqHist.
@@ -298,6 +1126,27 @@ public:
     /// @return Значение p-value.
     inline double get_p_value() const { return p_value; }
 
+    /// @brief Доступ к значению статистики согласия.
+    /// @details Кроме stat_pearson, статистики вычисляются, только если включены set_all_stats.
+    /// @param[in] _stat Статистика.
+    /// @return Значение статистики.
+    inline double get_stat(GofStat _stat) const { return stat[_stat]; }
+    /// @brief Доступ к p-value статистики согласия.
+    /// @param[in] _stat Статистика.
+    /// @return Значение p-value.
+    inline double get_stat_p_value(GofStat _stat) const { return stat_p_value[_stat]; }
+    /// @brief Доступ к p-value всех статистик согласия.
+    /// @return Указатель на массив из num_gof_stats p-value.
+    inline const double* get_stat_p_values() const { return stat_p_value; }
+
+    /// @brief Включение вычисления всех статистик согласия.
+    /// @details G-критерий и Фримана-Тьюки вычисляются по тем же объединённым состояниям и сравниваются с тем же
+    /// распределением \f$ \chi ^2 \f$, что и критерий Пирсона. Для статистик Колмогорова-Смирнова и Крамера-Мизеса используются
+    /// предельные распределения непрерывного случая (pKolmogorov, pCvM): для дискретного распределения критерий Колмогорова-Смирнова
+    /// консервативен, а уровень значимости критерия Крамера-Мизеса выдерживается приближённо.
+    /// @param[in] _all_stats Вычислять ли все статистики.
+    void set_all_stats(bool _all_stats);
+
     /// @brief Доступ к размеру массива с вероятностями.
     /// @return Размер массива с вероятностями.
     inline size_t get_num_freq() const { return num_freq; }
@@ -307,17 +1156,66 @@ public:
     inline const size_t* get_exp_freq() const { return exp_freq; }
     /// @brief Доступ к теоретическим вероятностям.
     /// @return Указатель на массив теоретических вероятностей.
-    inline const double* get_th_freq() const { return th_freq; }
+    inline const double* get_th_freq() const { return th_freq.get(); }
+
+    /// @brief Доступ к количеству объединённых состояний (план должен быть построен update_plan).
+    /// @return Количество объединённых состояний.
+    inline size_t get_num_merge() const { return num_merge; }
+    /// @brief Доступ к плану объединения.
+    /// @return Номер объединённого состояния для каждого состояния.
+    inline const size_t* get_merge_inx() const { return merge_inx.get(); }
+    /// @brief Доступ к объединённым теоретическим вероятностям.
+    /// @return Указатель на массив объединённых вероятностей.
+    inline const double* get_th_merge() const { return th_merge.get(); }
+    /// @brief Доступ к размеру выборки, для которого построен план объединения.
+    /// @return Размер выборки.
+    inline size_t get_plan_n() const { return plan_n; }
+
+    /// @brief Строит план объединения, если он не построен для текущего размера выборки.
+    void update_plan();
+
+    /// @brief Строит план объединения состояний, чтобы критерий был применим (в каждом объединённом состоянии \f$ n p_i \geq 5 \f$).
+    /// @param[in] num Количество состояний.
+    /// @param[in] th Теоретические вероятности состояний.
+    /// @param[in] n Размер выборки.
+    /// @param[out] inx Номер объединённого состояния для каждого состояния (массив размера num).
+    /// @return Количество объединённых состояний.
+    static size_t merge_plan(size_t num, const double* th, size_t n, size_t* inx);
 
     /// @brief Изменение распределения и метода моделирования, на основе, которых вычисляется критерий.
     /// @param[in] _d Указатель на распределение.
     /// @param[in] _s Указатель на метод моделирования.
     void set_data(NB_distr* _d, Sample* _s);
 
+    /// @brief Изменение метода моделирования без пересчёта теоретических вероятностей и плана объединения.
+    /// @param[in] _s Указатель на метод моделирования.
+    void set_sample(Sample* _s);
+
+    /// @brief Перенаправляет критерий на другие объекты распределения и метода моделирования с теми же параметрами без пересчёта.
+    /// @param[in] _d Указатель на распределение.
+    /// @param[in] _s Указатель на метод моделирования.
+    void rebind(NB_distr* _d, Sample* _s);
+
     /// @brief Составление таблицы теоретических вероятностей.
     void calc_th_freq();
     /// @brief Составление таблицы эмперических частот.
     void calc_exp_freq();
+    /// @brief Моделирование выборки и составление таблицы эмперических частот (Sample::simulate_freq).
+    /// @details Равносильно s->simulate() и calc_exp_freq(), но позволяет методу моделирования получать частоты сразу.
+    void simulate_exp_freq();
+    /// @brief Моделирование одной большой выборки в нескольких потоках и составление таблицы эмперических частот.
+    /// @details Выборка делится на блоки по parallel_block значений; блок b моделируется копией метода моделирования
+    /// генератором, инициированным block_seed(stream, b), и считается в частотах своего потока, которые в конце складываются.
+    /// Поэтому частоты зависят только от seed, stream и n, но не от количества потоков. Сама выборка не сохраняется,
+    /// а размер выборки критерия становится равным n (размер выборки метода моделирования не меняется).
+    /// @param[in] n Размер выборки.
+    /// @param[in] stream Номер выборки (разные номера дают независимые выборки).
+    /// @param[in] threads Количество потоков (0 - по количеству ядер).
+    void simulate_exp_freq_parallel(size_t n, uint64_t stream = 0, size_t threads = 0);
+
+    /// @brief Доступ к размеру выборки, по которой составлена таблица эмперических частот.
+    /// @return Размер выборки.
+    inline size_t get_freq_n() const { return freq_n; }
 
     /// @brief Вычисление критерия \f$ \chi ^2 \f$ и p-value.
     void calc_chi_sq();
@@ -326,6 +1224,385 @@ public:
     ~ChiSqHist();
 };
 
+/// @brief p-value критерия \f$ \chi ^2 \f$ для нескольких значений статистики с одинаковыми степенями свободы (pChiBatch).
+/// @param[in] chi_sq Значения статистики.
+/// @param[in] num Количество значений.
+/// @param[in] df Степени свободы.
+/// @param[out] p_value Массив для p-value размера не меньше num.
+void chi_sq_p_values(const double* chi_sq, size_t num, size_t df, double* p_value);
+
+/// @brief Количество повторений в пакете ChiSqBatch по умолчанию.
+const size_t batch_reps = 256;
+
+/// @brief Класс пакетного вычисления критерия \f$ \chi ^2 \f$ по многим повторениям.
+/// @details Объединённые частоты R повторений хранятся матрицей "структура массивов": строка - объединённое состояние,
+/// столбец - повторение, поэтому статистики всех повторений вычисляются одним проходом по строкам, а внутренний цикл
+/// по повторениям векторизуется. Используется равенство \f$ \sum_i (O_i - n p_i)^2 / (n p_i) = \sum_i O_i^2 w_i - n \f$
+/// с заранее вычисленными весами \f$ w_i = 1 / (n p_i) \f$ и целыми частотами. При T = float сумма вычисляется
+/// в одинарной точности; её абсолютная ошибка не больше \f$ (m + 3) u S \f$, где m - количество строк,
+/// u - единица округления T, S - сумма \f$ \sum_i O_i^2 w_i \f$ (evaluate возвращает эту границу).
+/// @tparam T Тип вычислений (double или float).
+template <class T>
+class ChiSqBatch
+{
+private:
+    /// @brief Количество строк (объединённых состояний).
+    size_t num_rows;
+    /// @brief Количество столбцов (повторений в пакете).
+    size_t num_reps;
+    /// @brief Количество добавленных повторений.
+    size_t filled;
+    /// @brief Размер выборки.
+    size_t n;
+    /// @brief Объединённые частоты, num_rows строк по num_reps.
+    uint32_t* counts;
+    /// @brief Веса строк.
+    T* weights;
+    /// @brief Суммы повторений.
+    T* acc;
+public:
+    /// @brief Конструктор по размеру пакета.
+    /// @param[in] _num_reps Количество повторений в пакете.
+    ChiSqBatch(size_t _num_reps = batch_reps) : num_rows(0), num_reps(_num_reps), filled(0), n(0), counts(nullptr), weights(nullptr),
+                                         acc(new T[_num_reps]) {}
+
+    ChiSqBatch(const ChiSqBatch& b) = delete;
+    ChiSqBatch& operator=(const ChiSqBatch& b) = delete;
+
+    /// @brief Задание плана объединения и размера выборки критерия c; добавленные повторения отбрасываются.
+    /// @param[in] c Критерий с построенным планом объединения (ChiSqHist::update_plan).
+    void set_plan(const ChiSqHist& c)
+    {
+        if (c.get_plan_n() > std::numeric_limits<uint32_t>::max())
+            throw "ChiSqBatch::set_plan: Sample size does not fit in 32-bit counts.";
+
+        if (c.get_num_merge() != num_rows)
+        {
+            delete[] counts;
+            delete[] weights;
+
+            num_rows = c.get_num_merge();
+            counts = new uint32_t[num_rows * num_reps];
+            weights = new T[num_rows];
+        }
+
+        n = c.get_plan_n();
+        filled = 0;
+
+        for (size_t i = 0; i < num_rows; ++i)
+            weights[i] = T(1 / (c.get_th_merge()[i] * n));
+    }
+
+    /// @brief Доступ к количеству добавленных повторений.
+    /// @return Количество повторений.
+    inline size_t size() const { return filled; }
+    /// @brief Заполнен ли пакет.
+    /// @return true, если добавлено num_reps повторений.
+    inline bool full() const { return filled == num_reps; }
+    /// @brief Доступ к степеням свободы.
+    /// @return Степени свободы.
+    inline size_t get_df() const { return num_rows - 1; }
+
+    /// @brief Добавляет эмперические частоты критерия c как следующее повторение.
+    /// @param[in] c Критерий с тем же планом объединения, что в set_plan.
+    void add(const ChiSqHist& c)
+    {
+        if (full())
+            throw "ChiSqBatch::add: The batch is full.";
+
+        const size_t* inx = c.get_merge_inx();
+        const size_t* freq = c.get_exp_freq();
+        uint32_t* col = counts + filled;
+
+        for (size_t i = 0; i < num_rows; ++i)
+            col[i * num_reps] = 0;
+
+        for (size_t i = 0; i < c.get_num_freq(); ++i)
+            col[inx[i] * num_reps] += uint32_t(freq[i]);
+
+        ++filled;
+    }
+
+    /// @brief Вычисляет статистики и p-value всех добавленных повторений и очищает пакет.
+    /// @param[out] chi_sq Массив для статистик размера не меньше size().
+    /// @param[out] p_value Массив для p-value размера не меньше size().
+    /// @param[out] err Массив для границ абсолютной ошибки статистик (может быть nullptr).
+    void evaluate(double* chi_sq, double* p_value, double* err = nullptr)
+    {
+        const size_t num = filled;
+
+        for (size_t r = 0; r < num; ++r)
+            acc[r] = 0;
+
+        for (size_t i = 0; i < num_rows; ++i)
+        {
+            const uint32_t* row = counts + i * num_reps;
+            const T w = weights[i];
+            T* a = acc;
+
+            for (size_t r = 0; r < num; ++r)
+            {
+                T o = T(row[r]);
+
+                a[r] += o * o * w;
+            }
+        }
+
+        const double bound = (num_rows + 3) * double(std::numeric_limits<T>::epsilon()) / 2;
+
+        for (size_t r = 0; r < num; ++r)
+        {
+            // Ошибка округления может сделать почти нулевую статистику отрицательной.
+            chi_sq[r] = std::max(double(acc[r]) - double(n), 0.0);
+
+            if (err)
+                err[r] = bound * double(acc[r]);
+        }
+
+        chi_sq_p_values(chi_sq, num, get_df(), p_value);
+        filled = 0;
+    }
+
+    /// @brief Деструктор ChiSqBatch.
+    ~ChiSqBatch()
+    {
+        delete[] counts;
+        delete[] weights;
+        delete[] acc;
+    }
+};
+
+/// @brief Класс аналитической мощности критерия \f$ \chi ^2 \f$.
+/// @details При больших n статистика \f$ \chi ^2 \f$ при альтернативе имеет приближённо нецентральное распределение \f$ \chi ^2 \f$
+/// с параметром нецентральности \f$ \lambda = n \sum_i (q_i - p_i)^2 / p_i \f$, где \f$ p_i \f$ и \f$ q_i \f$ - объединённые
+/// вероятности нулевой и альтернативной гипотез. Класс хранит таблицы вероятностей обеих гипотез и вычисляет мощность без моделирования.
+class ChiSqPower
+{
+private:
+    /// @brief Указатель на распределение нулевой гипотезы.
+    NB_distr* d0;
+    /// @brief Указатель на распределение альтернативной гипотезы.
+    NB_distr* d1;
+
+    /// @brief Размер массивов с вероятностями.
+    size_t num_freq;
+    /// @brief Теоретические вероятности нулевой гипотезы (неизменяемые, разделяются между копиями).
+    std::shared_ptr<const double> th0_freq;
+    /// @brief Теоретические вероятности альтернативной гипотезы, последнее состояние содержит весь хвост (неизменяемые, разделяются между копиями).
+    std::shared_ptr<const double> th1_freq;
+    /// @brief План объединения состояний.
+    size_t* merge_inx;
+
+    /// @brief Осуществляет обмен полями между объектом класса и переданным c.
+    /// @param[in, out] c Объект класса ChiSqPower.
+    void swap(ChiSqPower& c);
+public:
+    /// @brief Конструктор по указателям на распределения гипотез.
+    /// @param[in] _d0 Указатель на распределение нулевой гипотезы.
+    /// @param[in] _d1 Указатель на распределение альтернативной гипотезы.
+    ChiSqPower(NB_distr* _d0, NB_distr* _d1);
+
+    /// @brief Конструктор копирования.
+    /// @param[in] c Объект класса ChiSqPower.
+    ChiSqPower(const ChiSqPower& c);
+
+    /// @brief Конструктор перемещения.
+    /// @param[in] c Объект класса ChiSqPower.
+    ChiSqPower(ChiSqPower&& c);
+
+    /// @brief Оператор присваивания для класса ChiSqPower.
+    /// @param[in] c Объект класса ChiSqPower.
+    /// @return Результат присваивания, объект класса ChiSqPower.
+    ChiSqPower& operator=(ChiSqPower c);
+
+    /// @brief Изменение распределений гипотез.
+    /// @param[in] _d0 Указатель на распределение нулевой гипотезы.
+    /// @param[in] _d1 Указатель на распределение альтернативной гипотезы.
+    void set_data(NB_distr* _d0, NB_distr* _d1);
+
+    /// @brief Перенаправляет на другие объекты распределений с теми же параметрами без пересчёта.
+    /// @param[in] _d0 Указатель на распределение нулевой гипотезы.
+    /// @param[in] _d1 Указатель на распределение альтернативной гипотезы.
+    void rebind(NB_distr* _d0, NB_distr* _d1);
+
+    /// @brief Составление таблиц теоретических вероятностей обеих гипотез.
+    void calc_th_freq();
+
+    /// @brief Вычисление параметра нецентральности.
+    /// @param[in] n Размер выборки.
+    /// @param[out] df Степени свободы.
+    /// @return Параметр нецентральности \f$ \lambda \f$.
+    double noncentrality(size_t n, size_t& df);
+
+    /// @brief Вычисление мощности критерия.
+    /// @param[in] n Размер выборки.
+    /// @param[in] sign_lv Уровень значимости.
+    /// @return Приближённая мощность критерия.
+    double power(size_t n, double sign_lv);
+
+    /// @brief Вычисление кривой мощности по размерам выборки.
+    /// @param[in] num Количество точек.
+    /// @param[in] n_arr Размеры выборки.
+    /// @param[in] sign_lv Уровень значимости.
+    /// @param[out] power_arr Мощности для каждого размера выборки.
+    void power_curve(size_t num, const size_t* n_arr, double sign_lv, double* power_arr);
+
+    /// @brief Деструктор ChiSqPower.
+    ~ChiSqPower();
+};
+
+/// @brief Класс потокового эскиза выборки p-value.
+/// @details Хранит количество p-value в каждом из num_bins равных интервалов отрезка [0, 1], поэтому занимаемая память не зависит
+/// от размера выборки. Позволяет вычислять эмпирическую функцию распределения, квантили и мощность при любом уровне значимости
+/// с погрешностью по значению не больше 1 / num_bins. Эскизы с одинаковым количеством интервалов можно объединять.
+/// Функция распределения и квантили вычисляются по накопленным суммам интервалов, которые перестраиваются finish, merge
+/// и clear, поэтому ecdf требует O(1), а quantile - O(log num_bins) действий. p-value, добавленные add, учитываются после finish.
+class PValueSketch
+{
+private:
+    /// @brief Количество интервалов.
+    size_t num_bins;
+    /// @brief Количество p-value в каждом интервале.
+    size_t* bins;
+    /// @brief Общее количество p-value.
+    size_t count;
+    /// @brief Накопленные суммы: количество p-value в интервалах [0, i) для i от 0 до num_bins.
+    size_t* cum;
+
+    /// @brief Осуществляет обмен полями между объектом класса и переданным ps.
+    /// @param[in, out] ps Объект класса PValueSketch.
+    void swap(PValueSketch& ps);
+public:
+    /// @brief Конструктор по количеству интервалов.
+    /// @param[in] _num_bins Количество интервалов.
+    PValueSketch(size_t _num_bins = 65536);
+
+    /// @brief Конструктор копирования.
+    /// @param[in] ps Объект класса PValueSketch.
+    PValueSketch(const PValueSketch& ps);
+
+    /// @brief Конструктор перемещения.
+    /// @param[in] ps Объект класса PValueSketch.
+    PValueSketch(PValueSketch&& ps);
+
+    /// @brief Оператор присваивания для класса PValueSketch.
+    /// @param[in] ps Объект класса PValueSketch.
+    /// @return Результат присваивания, объект класса PValueSketch.
+    PValueSketch& operator=(PValueSketch ps);
+
+    /// @brief Доступ к количеству интервалов.
+    /// @return Количество интервалов.
+    inline size_t get_num_bins() const { return num_bins; }
+    /// @brief Доступ к общему количеству p-value.
+    /// @return Количество добавленных p-value.
+    inline size_t get_count() const { return count; }
+    /// @brief Доступ к количествам p-value в интервалах.
+    /// @return Указатель на массив количеств.
+    inline const size_t* get_bins() const { return bins; }
+
+    /// @brief Добавляет p-value в эскиз.
+    /// @param[in] p_value Значение p-value.
+    inline void add(double p_value)
+    {
+        size_t inx = p_value > 0 ? size_t(p_value * num_bins) : 0;
+
+        ++bins[inx < num_bins ? inx : num_bins - 1];
+        ++count;
+    }
+
+    /// @brief Объединяет эскиз с переданным ps.
+    /// @param[in] ps Объект класса PValueSketch с тем же количеством интервалов.
+    void merge(const PValueSketch& ps);
+
+    /// @brief Добавляет в эскиз количества p-value по интервалам (например, прочитанные из файла).
+    /// @param[in] _bins Количества p-value в интервалах.
+    /// @param[in] _num_bins Количество интервалов, должно совпадать с num_bins.
+    void merge(const uint64_t* _bins, size_t _num_bins);
+
+    /// @brief Очищает эскиз.
+    void clear();
+
+    /// @brief Перестраивает накопленные суммы после добавления p-value.
+    void finish();
+
+    /// @brief Эмпирическая функция распределения.
+    /// @param[in] x Значение.
+    /// @return Доля p-value, меньших x.
+    double ecdf(double x) const;
+
+    /// @brief Квантиль выборки p-value.
+    /// @param[in] q Уровень квантили из [0, 1].
+    /// @return Значение квантили.
+    double quantile(double q) const;
+
+    /// @brief Мощность критерия при уровне значимости sign_lv.
+    /// @param[in] sign_lv Уровень значимости.
+    /// @return Доля p-value, меньших уровня значимости.
+    inline double power(double sign_lv) const { return ecdf(sign_lv); }
+
+    /// @brief Деструктор PValueSketch.
+    ~PValueSketch();
+};
+
+/// @brief Класс выборок p-value дополнительных статистик согласия.
+/// @details Для каждой статистики GofStat, кроме stat_pearson (её выборку хранит Doc_NB), хранит отсортированный массив p-value
+/// или потоковый эскиз PValueSketch, так же как Doc_NB хранит выборку p-value критерия \f$ \chi ^2 \f$.
+class GofPValues
+{
+private:
+    /// @brief Размер выборок p-value.
+    size_t num_p_value;
+    /// @brief Массивы p-value (nullptr в режиме эскиза и для stat_pearson).
+    double* arr[num_gof_stats];
+    /// @brief Эскизы p-value (nullptr в режиме массива и для stat_pearson).
+    PValueSketch* sketch[num_gof_stats];
+
+    /// @brief Осуществляет обмен полями между объектом класса и переданным g.
+    /// @param[in, out] g Объект класса GofPValues.
+    void swap(GofPValues& g);
+public:
+    /// @brief Конструктор выборок p-value.
+    /// @param[in] _num_p_value Размер выборок p-value.
+    /// @param[in] num_bins Количество интервалов эскизов (0 - хранить в массивах).
+    GofPValues(size_t _num_p_value = 0, size_t num_bins = 0);
+
+    /// @brief Конструктор копирования.
+    /// @param[in] g Объект класса GofPValues.
+    GofPValues(const GofPValues& g);
+
+    /// @brief Конструктор перемещения.
+    /// @param[in] g Объект класса GofPValues.
+    GofPValues(GofPValues&& g);
+
+    /// @brief Оператор присваивания для класса GofPValues.
+    /// @param[in] g Объект класса GofPValues.
+    /// @return Результат присваивания, объект класса GofPValues.
+    GofPValues& operator=(GofPValues g);
+
+    /// @brief Добавляет p-value одного повторения.
+    /// @param[in] i Номер повторения (индекс в массивах).
+    /// @param[in] p_value p-value всех статистик (num_gof_stats значений, как ChiSqHist::get_stat_p_values).
+    void add(size_t i, const double* p_value);
+
+    /// @brief Сортирует массивы p-value после моделирования.
+    void finish();
+
+    /// @brief Эмпирическая функция распределения выборки p-value статистики.
+    /// @param[in] stat Статистика (кроме stat_pearson).
+    /// @param[in] x Значение.
+    /// @return Доля p-value, меньших x.
+    double ecdf(GofStat stat, double x) const;
+
+    /// @brief Квантиль выборки p-value статистики.
+    /// @param[in] stat Статистика (кроме stat_pearson).
+    /// @param[in] q Уровень квантили из [0, 1].
+    /// @return Значение квантили.
+    double quantile(GofStat stat, double q) const;
+
+    /// @brief Деструктор GofPValues.
+    ~GofPValues();
+};
+
 /// @brief Класс моделирования и гипотез.
 /// @details Класс, который хранит нулевую и альтернативную гипотезы, метод моделирования, объект критерия \f$ \chi ^2 \f$, выборку p_value, 
 /// уровень значимости. Позволяет менять параметры распеределений, методы моделирования, критерий и размер выборки p-value.
@@ -343,6 +1620,24 @@ private:
     Sample* s;
     /// @brief Указатель на критерий согласия \f$ \chi ^2 \f$.
     ChiSqHist *chisq;
+    /// @brief Указатель на аналитическую мощность критерия.
+    ChiSqPower *chipow;
+    /// @brief Указатель на генератор случайных чисел метода моделирования (по умолчанию - глобальный generator, у копии - own_gen).
+    std::default_random_engine* gen;
+    /// @brief Собственный генератор копии.
+    std::default_random_engine own_gen;
+    /// @brief Текущий метод моделирования.
+    SampleMethod method;
+    /// @brief Выбирается ли метод моделирования автоматически (по модели стоимости sample_cost).
+    bool auto_method;
+    /// @brief Устарели ли таблицы метода моделирования (изменились параметры моделируемой гипотезы).
+    bool sample_dirty;
+    /// @brief Устарели ли теоретические вероятности и план объединения критерия \f$ \chi ^2 \f$ (изменилась нулевая гипотеза).
+    bool chisq_dirty;
+    /// @brief Устарели ли теоретические вероятности аналитической мощности (изменилась одна из гипотез).
+    bool chipow_dirty;
+    /// @brief Соответствует ли выборка p-value текущим параметрам, кроме уровня значимости (тогда make_p_value её не пересчитывает).
+    bool p_value_ready;
 
     /// @brief Размер выборки p-value.
     size_t num_p_value;
@@ -350,6 +1645,58 @@ private:
     double sign_lv;
     /// @brief Выборка p-value.
     double* p_value_arr;
+    /// @brief Указатель на потоковый эскиз выборки p-value (используется вместо p_value_arr, если не nullptr).
+    PValueSketch* sketch;
+    /// @brief Указатель на выборки p-value дополнительных статистик согласия (nullptr, если они не вычисляются).
+    GofPValues* gof;
+    /// @brief Минимальный размер выборки, начиная с которого мощность вычисляется аналитически.
+    size_t analytic_min_n;
+    /// @brief Номер первого повторения при моделировании диапазона повторений.
+    size_t range_begin;
+    /// @brief Моделируется ли диапазон повторений (каждое повторение - из своего потока генератора).
+    bool range_mode;
+
+    /// @brief Путь к файлу контрольной точки (пустая строка - контрольные точки не сохраняются).
+    std::string checkpoint_path;
+    /// @brief Количество p-value между контрольными точками.
+    size_t checkpoint_every;
+    /// @brief Указатель на кэш результатов на диске (nullptr - кэш не используется).
+    ResultCache* cache;
+
+    /// @brief Моделирует выборку p-value, начиная с элемента from, сохраняя контрольные точки.
+    /// @param[in] from Количество уже смоделированных p-value.
+    void run_p_value(size_t from);
+    /// @brief Изменяет размер выборки p-value.
+    /// @param[in] _num_p_value Размер выборки p-value.
+    void resize_p_value(size_t _num_p_value);
+    /// @brief Создаёт пустые выборки p-value дополнительных статистик того же размера и вида (массив или эскиз), что и основная.
+    void reset_gof();
+    /// @brief Заполняет заголовок файла результатов текущими параметрами.
+    /// @param[out] head Заголовок.
+    void fill_header(ResultHeader& head) const;
+
+    /// @brief Ключ текущего эксперимента в кэше результатов.
+    /// @return Ключ.
+    uint64_t cache_key() const;
+    /// @brief Чтение выборки p-value из кэша.
+    /// @param[in] key Ключ эксперимента.
+    /// @return true, если выборка найдена и прочитана.
+    bool load_cached(uint64_t key);
+    /// @brief Запись выборки p-value в кэш. Ошибки записи выводятся в std::cerr и не прерывают работу.
+    /// @param[in] key Ключ эксперимента.
+    void store_cached(uint64_t key) const;
+
+    /// @brief Перенаправляет метод моделирования и критерии на собственные распределения и генератор объекта.
+    void rebind();
+
+    /// @brief Перестраивает устаревшие таблицы метода моделирования и критериев.
+    void update();
+
+    /// @brief Заменяет метод моделирования, сохраняя размер выборки.
+    /// @details Если метод и способ его выбора не изменились, метод моделирования и выборка p-value сохраняются.
+    /// @param[in] _method Метод моделирования.
+    /// @param[in] _auto_method Выбран ли метод автоматически.
+    void set_method(SampleMethod _method, bool _auto_method);
 
     /// @brief Осуществляет обмен полями между объектом класса и переданным d.
     /// @param[in, out] c Объект класса Doc_NB.
@@ -359,8 +1706,12 @@ public:
     Doc_NB();
 
     /// @brief Конструктор копирования.
+    /// @details Копия получает собственные метод моделирования, критерии и выборку p-value, а неизменяемые таблицы
+    /// (метода моделирования, теоретических вероятностей, плана объединения) разделяет с оригиналом,
+    /// поэтому копии для рабочих потоков создаются почти без затрат. Копия моделирует собственным генератором,
+    /// инициированным состоянием генератора d, и не изменяет генератор оригинала.
     /// @param[in] d Объект класса Doc_NB.
-    Doc_NB(Doc_NB &d);
+    Doc_NB(const Doc_NB &d);
 
     /// @brief Конструктор перемещения.
     /// @param[in] d Объект класса Doc_NB.
@@ -381,8 +1732,9 @@ public:
     /// @return Уровень значимости.
     inline double get_sign_lv() const { return sign_lv; }
     /// @brief Доступ к критерию согласию \f$ \chi ^2 \f$.
+    /// @details Устаревшие таблицы метода моделирования и критерия перед этим перестраиваются.
     /// @return Указатель на критерий согласия \f$ \chi ^2 \f$.
-    inline ChiSqHist* get_chi_sq() { return chisq; }
+    inline ChiSqHist* get_chi_sq() { update(); return chisq; }
     /// @brief Доступ к нулевой гипотезе.
     /// @return Указатель на нулевую гипотезу.
     inline const NB_distr* get_d0() const { return &d0; }
@@ -390,15 +1742,144 @@ public:
     /// @return Указатель на альтернативную гипотезу.
     inline const NB_distr* get_d1() const { return &d1; }
 
+    /// @brief Доступ к минимальному размеру выборки для аналитической мощности.
+    /// @return Минимальный размер выборки, начиная с которого мощность вычисляется аналитически.
+    inline size_t get_analytic_min_n() const { return analytic_min_n; }
+
     /// @brief Моделирование выборки p-value.
+    /// @details Если после прошлого вызова менялся только уровень значимости, выборка не пересчитывается.
+    /// Повторения моделируются так же, как make_p_value_range(0, N), поэтому выборка определяется параметрами и seed
+    /// и не зависит от того, задан ли кэш. Если задан кэш, выборка сначала ищется в нём, а смоделированная записывается в него.
     void make_p_value();
 
+    /// @brief Соответствует ли выборка p-value текущим параметрам.
+    /// @return true, если make_p_value не будет пересчитывать выборку.
+    inline bool is_p_value_ready() const { return p_value_ready; }
+
+    /// @brief Отмена сохранённой выборки p-value: следующий вызов make_p_value смоделирует новую выборку.
+    void discard_p_value();
+
+    /// @brief Моделирование части выборки p-value - повторений с номерами из [begin, end).
+    /// @details Каждое повторение моделируется из своего потока генератора, который определяется seed и номером повторения,
+    /// поэтому диапазоны можно моделировать в разных процессах, а объединение частей (merge_shards) совпадает
+    /// с результатом make_p_value_range(0, N). Размер выборки p-value становится равным end - begin.
+    /// @param[in] begin Номер первого повторения.
+    /// @param[in] end Номер, следующий за последним повторением.
+    void make_p_value_range(size_t begin, size_t end);
+
+    /// @brief Запись части результата, полученной make_p_value_range, в файл (см. File_NB.h).
+    /// @param[in] path Путь к файлу.
+    void save_shard(const char* path) const;
+
+    /// @brief Объединение частей результата в выборку p-value.
+    /// @details Параметры и seed частей должны совпадать с текущими, а диапазоны - покрывать [0, N) без пересечений.
+    /// Части должны храниться в том же виде (массив или эскиз), что и текущая выборка. Размер выборки p-value становится равным N.
+    /// @param[in] num Количество частей.
+    /// @param[in] paths Пути к файлам частей.
+    void merge_shards(size_t num, const char* const* paths);
+
+    /// @brief Включение сохранения контрольных точок при моделировании выборки p-value.
+    /// @details Контрольная точка содержит количество смоделированных p-value, состояние генератора и сами p-value (или эскиз).
+    /// Запись выполняется в отдельном потоке и не останавливает моделирование. В режиме массива p-value дописываются в файл path.pv.
+    /// @param[in] path Путь к файлу контрольной точки (nullptr или пустая строка - отключить).
+    /// @param[in] every Количество p-value между контрольными точками.
+    void set_checkpoint(const char* path, size_t every = 100000);
+
+    /// @brief Подключение кэша результатов на диске (см. Cache_NB.h).
+    /// @details Кэш не принадлежит объекту и должен существовать, пока используется. Выборки с дополнительными
+    /// статистиками (set_all_stats) в кэше не хранятся.
+    /// @param[in] _cache Указатель на кэш (nullptr - отключить).
+    void set_cache(ResultCache* _cache);
+
+    /// @brief Продолжение моделирования выборки p-value с контрольной точки.
+    /// @details Результат совпадает с результатом моделирования без прерывания. Параметры должны совпадать с параметрами,
+    /// при которых сохранена контрольная точка. Дальнейшие контрольные точки сохраняются в тот же файл.
+    /// @param[in] path Путь к файлу контрольной точки.
+    void resume_p_value(const char* path);
+
+    /// @brief Вычисление мощности моделированием выборки p-value.
+    /// @param[in] n Размер выборки.
+    /// @return Доля p-value, меньших уровня значимости.
+    double simulate_power(size_t n);
+
+    /// @brief Вычисление мощности через нецентральное распределение \f$ \chi ^2 \f$.
+    /// @param[in] n Размер выборки.
+    /// @return Приближённая мощность критерия.
+    double analytic_power(size_t n);
+
+    /// @brief Сравнение аналитической мощности с моделированием.
+    /// @param[in] n Размер выборки.
+    /// @return Модуль разности аналитической и смоделированной мощностей.
+    double check_power(size_t n);
+
+    /// @brief Вычисление кривой мощности: аналитически для n не меньше analytic_min_n, иначе моделированием.
+    /// @param[in] num Количество точек.
+    /// @param[in] n_arr Размеры выборки.
+    /// @param[out] power_arr Мощности для каждого размера выборки.
+    void power_curve(size_t num, const size_t* n_arr, double* power_arr);
+
+    /// @brief Изменение минимального размера выборки для аналитической мощности.
+    /// @param[in] _analytic_min_n Минимальный размер выборки (0 - всегда аналитически, SIZE_MAX - всегда моделированием).
+    void set_analytic_min_n(size_t _analytic_min_n);
+
     /// @brief Доступ к элементу выборки p-value.
+    /// @details При хранении в эскизе возвращается приближённое значение i-й порядковой статистики.
     /// @param[in] i Индекс элемента выборки p-value.
     /// @return Значение элемента выборки p-value.
     double get_p_value(size_t i) const;
 
+    /// @brief Эмпирическая функция распределения выборки p-value.
+    /// @param[in] x Значение.
+    /// @return Доля p-value, меньших x.
+    double p_value_ecdf(double x) const;
+
+    /// @brief Квантиль выборки p-value.
+    /// @param[in] q Уровень квантили из [0, 1].
+    /// @return Значение квантили.
+    double p_value_quantile(double q) const;
+
+    /// @brief Включение вычисления всех статистик согласия GofStat в каждом повторении.
+    /// @details Статистики вычисляются по той же таблице частот, что и \f$ \chi ^2 \f$, поэтому моделирование не повторяется.
+    /// Выборки p-value дополнительных статистик хранятся так же, как основная (в массиве или эскизе), но не сохраняются
+    /// в контрольных точках и частях результата.
+    /// @param[in] all_stats Вычислять ли все статистики.
+    void set_all_stats(bool all_stats);
+
+    /// @brief Вычисляются ли все статистики согласия.
+    /// @return true, если включено set_all_stats.
+    inline bool get_all_stats() const { return gof != nullptr; }
+
+    /// @brief Эмпирическая функция распределения выборки p-value статистики согласия.
+    /// @param[in] stat Статистика (для stat_pearson - p_value_ecdf).
+    /// @param[in] x Значение.
+    /// @return Доля p-value, меньших x.
+    double stat_ecdf(GofStat stat, double x) const;
+
+    /// @brief Квантиль выборки p-value статистики согласия.
+    /// @param[in] stat Статистика (для stat_pearson - p_value_quantile).
+    /// @param[in] q Уровень квантили из [0, 1].
+    /// @return Значение квантили.
+    double stat_quantile(GofStat stat, double q) const;
+
+    /// @brief Доступ к потоковому эскизу выборки p-value.
+    /// @return Указатель на эскиз или nullptr, если выборка хранится в массиве.
+    inline const PValueSketch* get_sketch() const { return sketch; }
+
+    /// @brief Запись результатов моделирования в двоичный файл (см. File_NB.h).
+    /// @param[in] path Путь к файлу.
+    /// @param[in] flags Дополнительные столбцы (комбинация ResultFlags): выборка и частоты.
+    void save_result(const char* path, unsigned flags = 0) const;
+
+    /// @brief Установка хранения выборки p-value в массиве (точные значения, память растёт с размером выборки).
+    void set_array_storage();
+    /// @brief Установка хранения выборки p-value в потоковом эскизе (память не зависит от размера выборки).
+    /// @details Если эскиз с тем же количеством интервалов уже используется, ничего не делает.
+    /// @param[in] num_bins Количество интервалов эскиза.
+    void set_sketch_storage(size_t num_bins = 65536);
+
     /// @brief Позволяет изменить параметры гипотез, размер выборки p-value, размер выборки и уровень значимости.
+    /// @details Перестраивается только то, что зависит от изменившихся параметров: таблицы метода моделирования
+    /// и критериев - при следующем обращении к ним, выборка p-value - при следующем make_p_value.
     /// @param[in] _d0 Нулевая гипотеза.
     /// @param[in] _d1 Альтернативная гипотеза.
     /// @param[in] _num_p_value Размер выборки p-value.
@@ -406,10 +1887,25 @@ public:
     /// @param[in] _sign_lv Уровень значимости.
     void change_param(NB_distr _d0, NB_distr _d1, size_t _num_p_value, size_t _n, double _sign_lv);
 
+    /// @brief Изменяет генератор случайных чисел, например, чтобы копии моделировали в разных потоках.
+    /// @param[in] _gen Указатель на генератор.
+    void set_generator(std::default_random_engine* _gen);
+
     /// @brief Установка в качестве метода моделирования табличного метода.
     void set_table_method();
     /// @brief Установка в качестве метода моделирования метода Бернулли.
     void set_bernulli_method();
+    /// @brief Установка в качестве метода моделирования табличного метода по целым числам генератора.
+    void set_int_table_method();
+    /// @brief Установка в качестве метода моделирования метода Бернулли с побитовым моделированием испытаний.
+    void set_bit_bernulli_method();
+    /// @brief Установка в качестве метода моделирования самого быстрого метода для текущих гипотезы и размера выборки.
+    /// @details Метод выбирается по модели стоимости sample_cost при вызове и не меняется при изменении параметров.
+    void set_auto_method();
+
+    /// @brief Выбран ли метод моделирования автоматически.
+    /// @return true, если метод установлен set_auto_method.
+    inline bool is_auto_method() const { return auto_method; }
 
     /// @brief Установка для моделирования нулевую гипотезу.
     void set_hyp_d0();
@@ -11,12 +11,40 @@ int comp_double (const void* a, const void* b)
 
 void My_Chart::draw()
 {
-    int x = this->x() + 2 * margin_w + text_graf_w;
-    int y = this->y() + text_graf_h;
+    if (!cache || cache_w != w() || cache_h != h())
+    {
+        if (cache)
+            fl_delete_offscreen(cache);
+
+        cache = fl_create_offscreen(w(), h());
+        cache_w = w();
+        cache_h = h();
+        dirty = true;
+    }
+
+    if (dirty)
+    {
+        fl_begin_offscreen(cache);
+        render(0, 0);
+        fl_end_offscreen();
+
+        dirty = false;
+    }
+
+    fl_copy_offscreen(x(), y(), w(), h(), cache, 0, 0);
+}
+
+void My_Chart::render(int x0, int y0)
+{
+    int x = x0 + 2 * margin_w + text_graf_w;
+    int y = y0 + text_graf_h;
     int w = this->w() - 3 * margin_w - 2 * text_graf_w;
     int h = this->h() - 3 * margin_h - 2 * text_graf_h;
 
-    Fl_Box::draw();
+    fl_color(color());
+    fl_rectf(x0, y0, this->w(), this->h());
+    draw_box(box(), x0, y0, this->w(), this->h(), color());
+
     fl_color(24);
     fl_line_style(FL_CAP_SQUARE, 2);
     fl_line(x, y - text_graf_h, x, y + h);
@@ -27,20 +55,32 @@ void My_Chart::draw()
     fl_line(x + w + text_graf_w, y + h, x + w + text_graf_w - 4, y + h + 4);
 }
 
-My_Chart::My_Chart(int x, int y, int w, int h, const char* s) : Fl_Box(x, y, w, h, s)
+void My_Chart::invalidate()
+{
+    dirty = true;
+    redraw();
+}
+
+My_Chart::My_Chart(int x, int y, int w, int h, const char* s) : Fl_Box(x, y, w, h, s), cache(0), cache_w(0), cache_h(0), dirty(true)
 {
     labelsize(5);
 }
 
-void My_Graf::draw()
+My_Chart::~My_Chart()
 {
-    int x = this->x() + 2 * margin_w + text_graf_w;
-    int y = this->y() + text_graf_h;
+    if (cache)
+        fl_delete_offscreen(cache);
+}
+
+void My_Graf::render(int x0, int y0)
+{
+    int x = x0 + 2 * margin_w + text_graf_w;
+    int y = y0 + text_graf_h;
     int w = this->w() - 3 * margin_w - 2 * text_graf_w;
     int h = this->h() - 3 * margin_h - 2 * text_graf_h;
     double dx = max_x - min_x, dy = max_y - min_y;
 
-    My_Chart::draw();
+    My_Chart::render(x0, y0);
     
     fl_font(FL_COURIER, 12);
     char str[10];
@@ -61,19 +101,45 @@ void My_Graf::draw()
         fl_draw(str, x - text_graf_w - margin_w, y_i + text_graf_h / 2);
     }
 
-    double pre_x = x + (x_point[0] - min_x) / dx * w, pre_y = y + (1 - (y_point[0] - min_y) / dy) * h;
-
     if (min_x == min_y && max_x == max_y)
         fl_line(x ,y + h, x + w, y);
-        
+
+    if (num == 0)
+        return;
+
+    auto to_x = [&](double v) { return x + (v - min_x) / dx * w; };
+    auto to_y = [&](double v) { return y + (1 - (v - min_y) / dy) * h; };
+
     fl_color(255, 0, 0);
 
-    if (num > 0)
-        fl_line(pre_x, pre_y, pre_x, pre_y);
+    if (num_lod)
+    {
+        // Каждый отрезок точек - линия от первой точки до последней и вертикаль от минимума до максимума.
+        double pre_x = to_x(lod[0].x_first), pre_y = to_y(lod[0].y_first);
+
+        for (size_t i = 0; i < num_lod; ++i)
+        {
+            double first_x = to_x(lod[i].x_first), first_y = to_y(lod[i].y_first);
+            double last_x = to_x(lod[i].x_last), last_y = to_y(lod[i].y_last);
+
+            fl_line(pre_x, pre_y, first_x, first_y);
+            fl_line(first_x, to_y(lod[i].y_min), first_x, to_y(lod[i].y_max));
+            fl_line(first_x, first_y, last_x, last_y);
+
+            pre_x = last_x;
+            pre_y = last_y;
+        }
+
+        return;
+    }
+
+    double pre_x = to_x(x_point[0]), pre_y = to_y(y_point[0]);
+
+    fl_line(pre_x, pre_y, pre_x, pre_y);
 
     for (size_t i = 1; i < num; ++i)
     {
-        double now_x = x + (x_point[i] - min_x) / dx * w, now_y = y + (1 - (y_point[i] - min_y) / dy) * h;
+        double now_x = to_x(x_point[i]), now_y = to_y(y_point[i]);
 
         fl_line(pre_x, pre_y, now_x, now_y);
 
@@ -85,34 +151,73 @@ void My_Graf::draw()
 My_Graf::My_Graf(int x, int y, int w, int h, const char* s) : My_Chart(x, y, w, h, s)
 {
     x_point = y_point = nullptr;
-    num = 0;
+    lod = nullptr;
+    num = capacity = num_lod = 0;
     labelsize(5);
 }
 
 void My_Graf::set_data(size_t _num, double* _x_point, double* _y_point)
 {
-    if (num != 0 && !_x_point)
+    if (_num != 0 && !_x_point)
         throw "My_Graf::set_data: If the number of elements is greater than 0, the array of x_points should not be empty.";
 
-    if (num != 0 && !_y_point)
+    if (_num != 0 && !_y_point)
         throw "My_Graf::set_data: If the number of elements is greater than 0, the array of y_points should not be empty.";
 
-    num = _num;
-
-    if (x_point)
+    // Массивы перевыделяются только при увеличении количества точек.
+    if (_num > capacity)
+    {
         delete[] x_point;
-
-    if (y_point)
         delete[] y_point;
 
-    x_point = new double[num];
-    y_point = new double[num];
-    
+        x_point = new double[_num];
+        y_point = new double[_num];
+        capacity = _num;
+    }
+
+    num = _num;
+
     memcpy(x_point, _x_point, num * sizeof(double));
     memcpy(y_point, _y_point, num * sizeof(double));
 
-    qsort(x_point, num, sizeof(double), comp_double);
-    qsort(y_point, num, sizeof(double), comp_double);
+    if (!std::is_sorted(x_point, x_point + num))
+        qsort(x_point, num, sizeof(double), comp_double);
+
+    if (!std::is_sorted(y_point, y_point + num))
+        qsort(y_point, num, sizeof(double), comp_double);
+
+    make_lod();
+    invalidate();
+}
+
+void My_Graf::make_lod()
+{
+    delete[] lod;
+    lod = nullptr;
+    num_lod = 0;
+
+    if (num <= lod_buckets)
+        return;
+
+    num_lod = lod_buckets;
+    lod = new Lod_Bucket[num_lod];
+
+    for (size_t i = 0; i < num_lod; ++i)
+    {
+        size_t begin = i * num / num_lod, end = (i + 1) * num / num_lod;
+        Lod_Bucket& b = lod[i];
+
+        b.x_first = x_point[begin];
+        b.y_first = b.y_min = b.y_max = y_point[begin];
+        b.x_last = x_point[end - 1];
+        b.y_last = y_point[end - 1];
+
+        for (size_t j = begin + 1; j < end; ++j)
+        {
+            b.y_min = std::min(b.y_min, y_point[j]);
+            b.y_max = std::max(b.y_max, y_point[j]);
+        }
+    }
 }
 
 void My_Graf::auto_minmax()
@@ -124,6 +229,8 @@ void My_Graf::auto_minmax()
     min_y = y_point[0];
     max_x = x_point[num - 1];
     max_y = y_point[num - 1];
+
+    invalidate();
 }
 
 void My_Graf::set_minmax(double _min_x, double _min_y, double _max_x, double _max_y)
@@ -138,28 +245,32 @@ void My_Graf::set_minmax(double _min_x, double _min_y, double _max_x, double _ma
     min_y = _min_y;
     max_x = _max_x;
     max_y = _max_y;
+
+    invalidate();
 }
 
 My_Graf::~My_Graf()
 {
     delete[] x_point;
     delete[] y_point;
+    delete[] lod;
 }
 
-void My_BarChart::draw()
+void My_BarChart::render(int x0, int y0)
 {
-    int x = this->x() + 2 * margin_w + text_graf_w;
-    int y = this->y() + text_graf_h;
+    int x = x0 + 2 * margin_w + text_graf_w;
+    int y = y0 + text_graf_h;
     int w = this->w() - 3 * margin_w - 2 * text_graf_w;
     int h = this->h() - 3 * margin_h - 2 * text_graf_h;
-    int w_bar = w / num * 4 / 5;
-    int w_bar_margin = w / num / 10;
     double dy = max_y - min_y;
 
-    My_Chart::draw();
+    My_Chart::render(x0, y0);
+
+    if (num == 0)
+        return;
     
     fl_font(FL_COURIER, 12);
-    char str[10];
+    char str[24];
 
     for (size_t i = 0; i <= max_part; ++i)
     {
@@ -172,24 +283,53 @@ void My_BarChart::draw()
 
     }
 
-    for (size_t i = 1; i <= num; ++i)
+    // Подписи столбцов не ближе ширины подписи друг к другу.
+    size_t step = std::max<size_t>(1, (num * (text_graf_w + margin_w) + w - 1) / std::max(w, 1));
+
+    for (size_t i = step; i <= num; i += step)
     {
         int x_i = x + i * (double(w) / num);
 
-        sprintf(str, "%lu", i);
+        sprintf(str, "%lu", first + i);
 
         fl_line(x_i, y + h - 3, x_i, y + h + 3);
         fl_draw(str, x_i - (text_graf_w / 2 + (double(w) / num)) / 2, y + h + text_graf_h + margin_h);
     }
 
-    for (size_t i = 0; i < num; ++i)
+    if (num <= size_t(w))
     {
-        double now_x = x + i * (double(w) / num);
+        int w_bar = w / num * 4 / 5;
+        int w_bar_margin = w / num / 10;
+
+        for (size_t i = 0; i < num; ++i)
+        {
+            double now_x = x + i * (double(w) / num);
+
+            fl_color(20);
+            fl_rectf(now_x + w_bar_margin, y + (dy - y1_point[i]) / dy * h, w_bar, y1_point[i] / dy * h);
+            fl_color(24);
+            fl_rectf(now_x + w_bar_margin + w_bar / 6, y + (dy - y2_point[i]) / dy * h, w_bar * 2 / 3, y2_point[i] / dy * h);
+        }
+
+        return;
+    }
+
+    // Столбцов больше, чем точек по ширине: каждый столбец пикселей показывает максимум попавших в него столбцов.
+    for (int c = 0; c < w; ++c)
+    {
+        size_t begin = size_t(c) * num / w, end = size_t(c + 1) * num / w;
+        double y1 = 0, y2 = 0;
+
+        for (size_t i = begin; i < end; ++i)
+        {
+            y1 = std::max(y1, y1_point[i]);
+            y2 = std::max(y2, y2_point[i]);
+        }
 
         fl_color(20);
-        fl_rectf(now_x + w_bar_margin, y + (dy - y1_point[i]) / dy * h, w_bar, y1_point[i] / dy * h);
+        fl_rectf(x + c, y + (dy - y1) / dy * h, 1, y1 / dy * h);
         fl_color(24);
-        fl_rectf(now_x + w_bar_margin + w_bar / 6, y + (dy - y2_point[i]) / dy * h, w_bar * 2 / 3, y2_point[i] / dy * h);
+        fl_rectf(x + c, y + (dy - y2) / dy * h, 1, y2 / dy * h);
     }
 }
 
@@ -197,37 +337,43 @@ My_BarChart::My_BarChart(int x, int y, int w, int h, const char* s) : My_Chart(x
 {
     y1_point = nullptr;
     y2_point = nullptr;
-    num = 0;
+    num = capacity = first = 0;
     labelsize(5);
 }
 
-void My_BarChart::set_data(size_t _num, double* _y1_point, double* _y2_point)
+void My_BarChart::set_data(size_t _num, double* _y1_point, double* _y2_point, size_t _first)
 {
-    if (num != 0 && !_y1_point && !_y2_point)
-        throw "My_Graf::set_data: If the number of elements is greater than 0, the array of y_points should not be empty.";
-
-    num = _num;
+    if (_num != 0 && (!_y1_point || !_y2_point))
+        throw "My_BarChart::set_data: If the number of elements is greater than 0, the arrays of y_points should not be empty.";
 
-    if (y1_point)
+    if (_num > capacity)
+    {
         delete[] y1_point;
-
-    if (y2_point)
         delete[] y2_point;
 
-    y1_point = new double[num];
-    y2_point = new double[num];
+        y1_point = new double[_num];
+        y2_point = new double[_num];
+        capacity = _num;
+    }
+
+    num = _num;
+    first = _first;
     
     memcpy(y1_point, _y1_point, num * sizeof(double));
     memcpy(y2_point, _y2_point, num * sizeof(double));
+
+    invalidate();
 }
 
 void My_BarChart::set_minmax(double _min_y, double _max_y)
 {
     if (_min_y > _max_y)
-        throw "My_Graf::set_minmax: min_y must be less than the max_y.";
+        throw "My_BarChart::set_minmax: min_y must be less than the max_y.";
 
     min_y = _min_y;
     max_y = _max_y;
+
+    invalidate();
 }
 
 My_BarChart::~My_BarChart()
@@ -272,13 +418,21 @@ void My_Icon_P_Value::draw()
 
 My_Icon_P_Value::My_Icon_P_Value(int x, int y, int w, int h, Chart _c, Doc_NB* _data) : My_Icon(x, y, w, h, _c, _data) {};
 
+/// Название метода моделирования для строки параметров; автоматически выбранный метод отмечается "Auto".
+std::string method_name(const Doc_NB* data)
+{
+    std::string name = data->get_Sample()->get_name();
+
+    return data->is_auto_method() ? "Auto, " + name : name;
+}
+
 void My_Icon_P_Value::change_output()
 {
-    char s[150];
+    char s[200];
 
-    sprintf(s, "Parametrs. H0: p = %.2f, k = %lu. H1: p = %.2f, k = %lu. Number of sample: %lu. Number of p-value: %lu. Method: %10s.",
+    sprintf(s, "Parametrs. H0: p = %g, k = %lu. H1: p = %g, k = %lu. Number of sample: %lu. Number of p-value: %lu. Method: %10s.",
             data->get_d0()->get_p(), data->get_d0()->get_k(), data->get_d1()->get_p(), data->get_d1()->get_k(), data->get_Sample()->get_n(),
-            data->get_num_p_value(), data->get_Sample()->get_name());
+            data->get_num_p_value(), method_name(data).c_str());
 
     c.out_param->value(s);
 }
@@ -290,28 +444,42 @@ void My_Icon_P_Value::on_press(void *user)
     c.g_power->hide();
     change_output();
 
-    double *sort_p_value_arr = new double[21]{};
-    double x_point[21];
-
-    sort_p_value_arr[0] = 0;
-
     data->make_p_value();
 
-    for (size_t i = 0, j = 0; i <= 20; ++i)
-    {
-        x_point[i] = 0.05 * i;
+    const PValueSketch* sketch = data->get_sketch();
+    size_t num = sketch ? sketch->get_num_bins() : std::min<size_t>(data->get_num_p_value(), max_plot_points);
+    double *x_point = new double[num];
+    double *y_point = new double[num];
 
-        while (data->get_p_value(j) < x_point[i] && data->get_p_value(j) != -1)
-            ++j;
-        
-        sort_p_value_arr[i] = double(j) / data->get_num_p_value();
+    if (sketch)
+    {
+        // По эскизу функция распределения строится одним проходом по интервалам: точка на правой границе каждого интервала.
+        const size_t* bins = sketch->get_bins();
+        size_t res = 0, count = std::max<size_t>(sketch->get_count(), 1);
+
+        for (size_t i = 0; i < num; ++i)
+        {
+            res += bins[i];
+            x_point[i] = double(i + 1) / num;
+            y_point[i] = double(res) / count;
+        }
+    }
+    else
+    {
+        // Эмпирическая функция распределения строится по квантилям, не более чем по max_plot_points точкам.
+        for (size_t i = 0; i < num; ++i)
+        {
+            y_point[i] = double(i + 1) / num;
+            x_point[i] = data->p_value_quantile(double(i) / num);
+        }
     }
 
-    c.g_p_level->set_data(21, x_point, sort_p_value_arr);
+    c.g_p_level->set_data(num, x_point, y_point);
     c.g_p_level->set_minmax(0, 0, 1, 1);
     c.g_p_level->show();
 
-    delete[] sort_p_value_arr;
+    delete[] x_point;
+    delete[] y_point;
 }
 
 void My_Icon_Power::draw()
@@ -337,11 +505,11 @@ My_Icon_Power::My_Icon_Power(int x, int y, int w, int h, Chart _c, Doc_NB* _data
 
 void My_Icon_Power::change_output()
 {
-    char s[150];
+    char s[200];
 
-    sprintf(s, "Parametrs. H0: p = %.2f, k = %lu. H1: p = %.2f, k = %lu. Significance level: %.2f. Method: %10s.",
+    sprintf(s, "Parametrs. H0: p = %g, k = %lu. H1: p = %g, k = %lu. Significance level: %.2f. Method: %10s.",
             data->get_d0()->get_p(), data->get_d0()->get_k(), data->get_d1()->get_p(), data->get_d1()->get_k(),
-            data->get_sign_lv(), data->get_Sample()->get_name());
+            data->get_sign_lv(), method_name(data).c_str());
 
     c.out_param->value(s);
 }
@@ -353,23 +521,21 @@ void My_Icon_Power::on_press(void *user)
     c.g_power->hide();
     change_output();
 
-    size_t num_n = 20, len_n = 5, start_n = 50, back_n = data->get_Sample()->get_n();
+    size_t num_n = 20, len_n = 5, start_n = 50;
     double *power_arr = new double[num_n]{};
     double x_point[num_n], max_y = 0, min_y = 1;
+    size_t n_arr[num_n];
 
     for (size_t i = 0; i < num_n; ++i)
     {
-        size_t j = 0;
-        x_point[i] = len_n * i + start_n;
-        data->get_Sample()->change_param(x_point[i]);
-
-        data->make_p_value();
+        n_arr[i] = len_n * i + start_n;
+        x_point[i] = n_arr[i];
+    }
 
-        while (data->get_p_value(j) < data->get_sign_lv() && data->get_p_value(j) != -1)
-            ++j;
-        
-        power_arr[i] = double(j) / data->get_num_p_value();
+    data->power_curve(num_n, n_arr, power_arr);
 
+    for (size_t i = 0; i < num_n; ++i)
+    {
         if (max_y < power_arr[i])
             max_y = power_arr[i];
 
@@ -377,7 +543,6 @@ void My_Icon_Power::on_press(void *user)
             min_y = power_arr[i];
     }
 
-    data->get_Sample()->change_param(back_n);
     c.g_power->set_data(num_n, x_point, power_arr);
     c.g_power->set_minmax(start_n, min_y, len_n * (num_n - 1) + start_n, max_y);
     c.g_power->show();
@@ -408,11 +573,11 @@ My_Icon_Bar::My_Icon_Bar(int x, int y, int w, int h, Chart _c, Doc_NB* _data) :
 
 void My_Icon_Bar::change_output()
 {
-    char s[150];
+    char s[200];
 
-    sprintf(s, "Parametrs. H0: p = %.2f, k = %lu. H1: p = %.2f, k = %lu. Number of sample: %lu. Method: %10s.",
+    sprintf(s, "Parametrs. H0: p = %g, k = %lu. H1: p = %g, k = %lu. Number of sample: %lu. Method: %10s.",
             data->get_d0()->get_p(), data->get_d0()->get_k(), data->get_d1()->get_p(), data->get_d1()->get_k(), data->get_Sample()->get_n(),
-            data->get_Sample()->get_name());
+            method_name(data).c_str());
 
     c.out_param->value(s);
 }
@@ -425,17 +590,22 @@ void My_Icon_Bar::on_press(void *user)
     change_output();
 
     double max_mean = 0;
+    size_t num_freq = data->get_chi_sq()->get_num_freq(), num = std::min<size_t>(bar_states, num_freq), start = 0;
+    const double* th = data->get_chi_sq()->get_th_freq();
 
-    double *exp_freq = new double[data->get_chi_sq()->get_num_freq()];
-    double *th_freq = new double[data->get_chi_sq()->get_num_freq()];
+    double *exp_freq = new double[num];
+    double *th_freq = new double[num];
 
-    data->get_Sample()->simulate();
-    data->get_chi_sq()->calc_exp_freq();
+    data->get_chi_sq()->simulate_exp_freq();
 
-    for (size_t i = 0; i < data->get_chi_sq()->get_num_freq(); ++i)
+    // Показываются bar_states состояний вокруг наиболее вероятного.
+    start = std::max_element(th, th + num_freq) - th;
+    start = std::min(start - std::min(start, num / 2), num_freq - num);
+
+    for (size_t i = 0; i < num; ++i)
     {
-        th_freq[i] = data->get_Sample()->get_n() * data->get_chi_sq()->get_th_freq()[i];
-        exp_freq[i] = data->get_chi_sq()->get_exp_freq()[i];
+        th_freq[i] = data->get_Sample()->get_n() * th[start + i];
+        exp_freq[i] = data->get_chi_sq()->get_exp_freq()[start + i];
 
         if (max_mean < th_freq[i])
             max_mean = th_freq[i];
@@ -444,7 +614,7 @@ void My_Icon_Bar::on_press(void *user)
             max_mean = exp_freq[i];
     }
 
-    c.b->set_data(15, th_freq, exp_freq);
+    c.b->set_data(num, th_freq, exp_freq, data->get_d0()->get_lo() + start);
     c.b->set_minmax(0, max_mean);
     c.b->show();
 
@@ -502,16 +672,16 @@ void My_Button_Dialog_Ok::on_press(void *user)
     ns = std::stoi(((My_Dialog*)user)->ii_ns->value());
     ah = std::stod(((My_Dialog*)user)->if_ah->value());
 
-    if (d0_k <= 0 || d0_k > 50)
+    if (d0_k <= 0 || d0_k > max_dialog_k)
     {
-        fl_alert("Param. k of hypothesis 0 must be greater than 0 and less 50!\nThe default value is set: 10");
+        fl_alert("Param. k of hypothesis 0 must be greater than 0 and not greater than %d!\nThe default value is set: 10", int(max_dialog_k));
 
         ((My_Dialog*)user)->ii_d0->value("10");
 
         return;
     }
 
-    if (d0_p < 0 || d0_p > 1)
+    if (d0_p <= 0 || d0_p >= 1)
     {
         fl_alert("Param. p of hypothesis 0 must be greater than 0 and less 1!\nThe default value is set: 0.8");
 
@@ -520,16 +690,16 @@ void My_Button_Dialog_Ok::on_press(void *user)
         return;
     }
 
-    if (d1_k <= 0 || d1_k > 50)
+    if (d1_k <= 0 || d1_k > max_dialog_k)
     {
-        fl_alert("Param. k of hypothesis 1 must be greater than 0 and less 50!\nThe default value is set: 10");
+        fl_alert("Param. k of hypothesis 1 must be greater than 0 and not greater than %d!\nThe default value is set: 10", int(max_dialog_k));
 
         ((My_Dialog*)user)->ii_d1->value("10");
 
         return;
     }
 
-    if (d1_p < 0 || d1_p > 1)
+    if (d1_p <= 0 || d1_p >= 1)
     {
         fl_alert("Param. p of hypothesis 1 must be greater than 0 and less 1!\nThe default value is set: 0.8");
 
@@ -538,9 +708,9 @@ void My_Button_Dialog_Ok::on_press(void *user)
         return;
     }
 
-    if (np <= 0 || np > 100000)
+    if (np <= 0 || np > 1000000000)
     {
-        fl_alert("Param. number of p-value must be greater than 0 and less 100000!\nThe default value is set: 10000");
+        fl_alert("Param. number of p-value must be greater than 0 and less 1000000000!\nThe default value is set: 10000");
 
         ((My_Dialog*)user)->ii_np->value("10000");
 
@@ -565,8 +735,15 @@ void My_Button_Dialog_Ok::on_press(void *user)
         return;
     }
 
+    // Большие выборки p-value хранятся в эскизе, чтобы память не зависела от их размера.
+    if (np > max_array_p_value)
+        ((My_Dialog*)user)->get_data()->set_sketch_storage();
+
     ((My_Dialog*)user)->get_data()->change_param(NB_distr(d0_p, d0_k), NB_distr(d1_p, d1_k), np, ns, ah);
 
+    if (np <= max_array_p_value)
+        ((My_Dialog*)user)->get_data()->set_array_storage();
+
     if (((My_Dialog*)user)->rb_h0->value())
         ((My_Dialog*)user)->get_data()->set_hyp_d0();
     else
@@ -574,8 +751,10 @@ void My_Button_Dialog_Ok::on_press(void *user)
 
     if (((My_Dialog*)user)->rb_mb->value())
         ((My_Dialog*)user)->get_data()->set_bernulli_method();
-    else
+    else if (((My_Dialog*)user)->rb_mt->value())
         ((My_Dialog*)user)->get_data()->set_table_method();
+    else
+        ((My_Dialog*)user)->get_data()->set_auto_method();
 
     ((My_Dialog*)user)->hide();                                   
 }
@@ -593,11 +772,11 @@ void close_dialog_callback(Fl_Widget* w, void* user)
 
     sprintf(buff, "%lu", ((Doc_NB*)user)->get_d0()->get_k());
     ((My_Dialog*)w)->ii_d0->value(buff);
-    sprintf(buff, "%.2f", ((Doc_NB*)user)->get_d0()->get_p());
+    sprintf(buff, "%g", ((Doc_NB*)user)->get_d0()->get_p());
     ((My_Dialog*)w)->if_d0->value(buff);
     sprintf(buff, "%lu", ((Doc_NB*)user)->get_d1()->get_k());
     ((My_Dialog*)w)->ii_d1->value(buff);
-    sprintf(buff, "%.2f", ((Doc_NB*)user)->get_d1()->get_p());
+    sprintf(buff, "%g", ((Doc_NB*)user)->get_d1()->get_p());
     ((My_Dialog*)w)->if_d1->value(buff);
     sprintf(buff, "%lu", ((Doc_NB*)user)->get_Sample()->get_n());
     ((My_Dialog*)w)->ii_ns->value(buff);
@@ -633,29 +812,30 @@ My_Dialog::My_Dialog(int w, int h, char* title, Doc_NB* _data) : Fl_Window(w, h,
     if_ah = new Fl_Float_Input(3 * margin_w + sign_w + input_w, 6 * margin_h + 5 * input_h, input_w + sign_w, input_h, "");
     if_ah->value("0.05");
 
-    Fl_Group* rb_method_g = new Fl_Group(4 * margin_w + 2 * sign_w + 2 * input_w, 0, input_w + sign_w + 2 * margin_w, 3 * input_h + 4 * margin_h, "");
+    Fl_Group* rb_method_g = new Fl_Group(4 * margin_w + 2 * sign_w + 2 * input_w, 0, input_w + sign_w + 2 * margin_w, 4 * input_h + 5 * margin_h, "");
 
     Fl_Box* method = new Fl_Box(5 * margin_w + 2 * sign_w + 2 * input_w, margin_h, input_w + sign_w, input_h, "Method:");
     rb_mb = new Fl_Radio_Round_Button(5 * margin_w + 2 * sign_w + 2 * input_w, 2 * margin_h + input_h, input_w + sign_w, input_h, "Bernulli");
     rb_mt = new Fl_Radio_Round_Button(5 * margin_w + 2 * sign_w + 2 * input_w, 3 * margin_h + 2 * input_h, input_w + sign_w, input_h, "Table");
+    rb_ma = new Fl_Radio_Round_Button(5 * margin_w + 2 * sign_w + 2 * input_w, 4 * margin_h + 3 * input_h, input_w + sign_w, input_h, "Auto");
 
     rb_mb->setonly();
 
     rb_method_g->end();
 
-    Fl_Group* rb_hup_g = new Fl_Group(4 * margin_w + 2 * sign_w + 2 * input_w, 4 * margin_h + 3 * input_h, input_w + sign_w + 2 * margin_w, 3 * input_h + 4 * margin_h, "");
+    Fl_Group* rb_hup_g = new Fl_Group(4 * margin_w + 2 * sign_w + 2 * input_w, 5 * margin_h + 4 * input_h, input_w + sign_w + 2 * margin_w, 3 * input_h + 4 * margin_h, "");
 
-    Fl_Box* hyp = new Fl_Box(5 * margin_w + 2 * sign_w + 2 * input_w, 5 * margin_h + 3 * input_h, input_w + sign_w, input_h, "Hypothesis:");
-    rb_h0 = new Fl_Radio_Round_Button(5 * margin_w + 2 * sign_w + 2 * input_w, 6 * margin_h + 4 * input_h, input_w + sign_w, input_h, "H0");
-    rb_h1 = new Fl_Radio_Round_Button(5 * margin_w + 2 * sign_w + 2 * input_w, 7 * margin_h + 5 * input_h, input_w + sign_w, input_h, "H1");
+    Fl_Box* hyp = new Fl_Box(5 * margin_w + 2 * sign_w + 2 * input_w, 6 * margin_h + 4 * input_h, input_w + sign_w, input_h, "Hypothesis:");
+    rb_h0 = new Fl_Radio_Round_Button(5 * margin_w + 2 * sign_w + 2 * input_w, 7 * margin_h + 5 * input_h, input_w + sign_w, input_h, "H0");
+    rb_h1 = new Fl_Radio_Round_Button(5 * margin_w + 2 * sign_w + 2 * input_w, 8 * margin_h + 6 * input_h, input_w + sign_w, input_h, "H1");
 
     rb_h0->setonly();
 
     rb_hup_g->end();
 
-    My_Button_Dialog_Ok* b_ok = new My_Button_Dialog_Ok(w / 2 - button_w - margin_w, 7 * margin_h + 6 * input_h, button_w, button_h, this); 
+    My_Button_Dialog_Ok* b_ok = new My_Button_Dialog_Ok(w / 2 - button_w - margin_w, 9 * margin_h + 7 * input_h, button_w, button_h, this); 
 
-    My_Button_Dialog_Close* b_close = new My_Button_Dialog_Close(w / 2 + margin_w, 7 * margin_h + 6 * input_h, button_w, button_h, this);   
+    My_Button_Dialog_Close* b_close = new My_Button_Dialog_Close(w / 2 + margin_w, 9 * margin_h + 7 * input_h, button_w, button_h, this);   
 
     end();
     hide();
@@ -734,7 +914,7 @@ int Draw_NB::run()
 {
     int win_h = menu_h + fast_button_h + graf_h + text_h + bottom_text_h + 5 * margin_h;
     int win_w = graf_w + 2 * margin_w;
-    int win_set_h = 6 * input_h + 9 * margin_h + button_h;
+    int win_set_h = 7 * input_h + 11 * margin_h + button_h;
     int win_set_w = 3 * input_w + 6 * margin_w + 3 * sign_w;
 
     My_Dialog *win_setting = new My_Dialog(win_set_w, win_set_h, "Setting", data);
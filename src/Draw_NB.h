@@ -12,6 +12,7 @@
 #include <Fl/Fl_Radio_Round_Button.H>
 #include <Fl/fl_ask.H>
 #include <FL/fl_draw.H>
+#include <FL/x.H>
 
 #include "Doc_NB.h"
 
@@ -34,7 +35,14 @@ enum
     input_w = 80,
     input_h = 30,
     button_h = 40,
-    button_w = 80
+    button_w = 80,
+
+    max_dialog_k = 1000000,
+    bar_states = 15,
+
+    max_array_p_value = 100000,
+    max_plot_points = 1000000,
+    lod_buckets = 4096
 };
 
 void setting_callback(Fl_Widget *w, void* user);
@@ -50,23 +58,44 @@ struct Chart
     Fl_Output* out_param;
 };
 
+// Графики рисуются в закадровый буфер, который перестраивается только при изменении данных или размера,
+// а при перерисовке окна копируется на экран.
 class My_Chart : public Fl_Box
 {
+    Fl_Offscreen cache;
+    int cache_w, cache_h;
+    bool dirty;
 protected:
     void draw();
+
+    virtual void render(int x0, int y0);
+
+    void invalidate();
 public:
     My_Chart(int x, int y, int w, int h, const char* s);
+
+    ~My_Chart();
+};
+
+// Отрезок точек графика, который рисуется одной вертикальной линией от минимума до максимума.
+struct Lod_Bucket
+{
+    double x_first, y_first, x_last, y_last, y_min, y_max;
 };
 
 class My_Graf : public My_Chart
 {
     const size_t max_part = 20;
-    size_t num;
+    size_t num, capacity;
     double min_x, min_y, max_x, max_y;
     double *x_point;
     double *y_point;
+    size_t num_lod;
+    Lod_Bucket *lod;
+
+    void make_lod();
 protected:
-    void draw();
+    virtual void render(int x0, int y0) override;
 public:
     My_Graf(int x, int y, int w, int h, const char* s);
 
@@ -82,16 +111,16 @@ public:
 class My_BarChart : public My_Chart
 {
     const size_t max_part = 20;
-    size_t num;
+    size_t num, capacity, first;
     double min_y, max_y;
     double *y1_point;
     double *y2_point;
 protected:
-    void draw();
+    virtual void render(int x0, int y0) override;
 public:
     My_BarChart(int x, int y, int w, int h, const char* s);
 
-    void set_data(size_t _num, double* _y1_point, double* _y2_point);
+    void set_data(size_t _num, double* _y1_point, double* _y2_point, size_t _first = 0);
 
     void set_minmax(double _min_y, double _max_y);
 
@@ -180,6 +209,7 @@ public:
     Fl_Float_Input* if_ah;
     Fl_Radio_Round_Button* rb_mb;
     Fl_Radio_Round_Button* rb_mt;
+    Fl_Radio_Round_Button* rb_ma;
     Fl_Radio_Round_Button* rb_h0;
     Fl_Radio_Round_Button* rb_h1;
 };
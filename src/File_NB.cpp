@@ -0,0 +1,206 @@
+#include <cstdio>
+#include <cstring>
+#include "File_NB.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static_assert(sizeof(ResultHeader) == 120, "ResultHeader layout must not depend on the compiler.");
+static_assert(sizeof(ResultColumnInfo) == 24, "ResultColumnInfo layout must not depend on the compiler.");
+
+const size_t result_align = 64;
+
+static const char result_magic[8] = {'N', 'B', 'R', 'E', 'S', 'U', 'L', 'T'};
+
+size_t size_of_type(uint32_t type)
+{
+    if (type == type_f64 || type == type_u64)
+        return 8;
+
+    return type == type_u8 ? 1 : 0;
+}
+
+size_t align_up(size_t x)
+{
+    return (x + result_align - 1) / result_align * result_align;
+}
+
+void write_result(const char* path, ResultHeader head, size_t num_columns, const ResultColumn* columns)
+{
+    memcpy(head.magic, result_magic, sizeof(head.magic));
+    head.version = result_version;
+    head.num_columns = num_columns;
+
+    ResultColumnInfo* dir = new ResultColumnInfo[num_columns];
+    size_t offset = align_up(sizeof(ResultHeader) + num_columns * sizeof(ResultColumnInfo));
+
+    for (size_t i = 0; i < num_columns; ++i)
+    {
+        if (size_of_type(columns[i].type) == 0)
+        {
+            delete[] dir;
+            throw "write_result: Unknown column type.";
+        }
+
+        dir[i].id = columns[i].id;
+        dir[i].type = columns[i].type;
+        dir[i].count = columns[i].count;
+        dir[i].offset = offset;
+
+        offset = align_up(offset + columns[i].count * size_of_type(columns[i].type));
+    }
+
+    FILE* f = fopen(path, "wb");
+
+    if (!f)
+    {
+        delete[] dir;
+        throw "write_result: Unable to open file for writing.";
+    }
+
+    static const char zeros[result_align] = {};
+    bool ok = fwrite(&head, sizeof(head), 1, f) == 1;
+
+    if (num_columns > 0)
+        ok = ok && fwrite(dir, sizeof(ResultColumnInfo), num_columns, f) == num_columns;
+
+    size_t pos = sizeof(ResultHeader) + num_columns * sizeof(ResultColumnInfo);
+
+    for (size_t i = 0; i < num_columns && ok; ++i)
+    {
+        size_t bytes = columns[i].count * size_of_type(columns[i].type);
+
+        ok = fwrite(zeros, 1, dir[i].offset - pos, f) == dir[i].offset - pos;
+        ok = ok && (bytes == 0 || fwrite(columns[i].data, 1, bytes, f) == bytes);
+        pos = dir[i].offset + bytes;
+    }
+
+    delete[] dir;
+
+    if (fclose(f) != 0 || !ok)
+        throw "write_result: Error while writing file.";
+}
+
+void Result_NB::swap(Result_NB& r)
+{
+    const unsigned char* buff_data = data;
+    data = r.data, r.data = buff_data;
+    size_t buff_size = size;
+    size = r.size, r.size = buff_size;
+    void* buff_handle = handle;
+    handle = r.handle, r.handle = buff_handle;
+}
+
+Result_NB::Result_NB(const char* path) : data(nullptr), size(0), handle(nullptr)
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+    if (file == INVALID_HANDLE_VALUE)
+        throw "Result_NB::Result_NB: Unable to open file.";
+
+    LARGE_INTEGER file_size;
+    GetFileSizeEx(file, &file_size);
+    size = file_size.QuadPart;
+
+    if (size >= sizeof(ResultHeader))
+    {
+        handle = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+
+        if (handle)
+            data = (const unsigned char*)MapViewOfFile(handle, FILE_MAP_READ, 0, 0, 0);
+    }
+
+    CloseHandle(file);
+#else
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0)
+        throw "Result_NB::Result_NB: Unable to open file.";
+
+    struct stat st;
+
+    if (fstat(fd, &st) == 0)
+        size = st.st_size;
+
+    if (size >= sizeof(ResultHeader))
+    {
+        void* p = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+
+        if (p != MAP_FAILED)
+            data = (const unsigned char*)p;
+    }
+
+    close(fd);
+#endif
+
+    if (!data)
+    {
+        unmap();
+        throw "Result_NB::Result_NB: Unable to map file.";
+    }
+
+    const ResultHeader& head = get_header();
+
+    if (memcmp(head.magic, result_magic, sizeof(head.magic)) != 0 || head.version != result_version ||
+        sizeof(ResultHeader) + head.num_columns * sizeof(ResultColumnInfo) > size)
+    {
+        unmap();
+        throw "Result_NB::Result_NB: File is not a result file of a supported version.";
+    }
+}
+
+Result_NB::Result_NB(Result_NB&& r) : data(nullptr), size(0), handle(nullptr)
+{
+    this->swap(r);
+}
+
+const void* Result_NB::get_column(uint32_t id, uint32_t type, size_t& count) const
+{
+    const ResultColumnInfo* dir = (const ResultColumnInfo*)(data + sizeof(ResultHeader));
+
+    count = 0;
+
+    for (size_t i = 0; i < get_header().num_columns; ++i)
+    {
+        if (dir[i].id != id)
+            continue;
+
+        if (dir[i].type != type || dir[i].offset > size || dir[i].count > (size - dir[i].offset) / size_of_type(type))
+            throw "Result_NB::get_column: Column is damaged or has an unexpected type.";
+
+        count = dir[i].count;
+
+        return data + dir[i].offset;
+    }
+
+    return nullptr;
+}
+
+void Result_NB::unmap()
+{
+#ifdef _WIN32
+    if (data)
+        UnmapViewOfFile(data);
+
+    if (handle)
+        CloseHandle(handle);
+#else
+    if (data)
+        munmap((void*)data, size);
+#endif
+
+    data = nullptr;
+    handle = nullptr;
+}
+
+Result_NB::~Result_NB()
+{
+    unmap();
+}
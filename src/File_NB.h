@@ -0,0 +1,192 @@
+/// @file
+/// @brief Двоичный формат файлов с результатами моделирования.
+/// @details Файл состоит из заголовка фиксированного размера (параметры гипотез, размеры выборок, seed, метод моделирования),
+/// каталога столбцов и самих столбцов. Каждый столбец - непрерывный массив чисел фиксированного типа, выровненный на 64 байта,
+/// поэтому при чтении через отображение файла в память (mmap) к столбцам можно обращаться напрямую, без копирования и разбора текста.
+/// Числа записываются в порядке байт машины, на которой создан файл.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/// @brief Версия формата файла.
+const uint32_t result_version = 1;
+
+/// @brief Идентификаторы столбцов.
+enum ResultColumnId
+{
+    /// @brief Отсортированная выборка p-value (double).
+    column_p_value = 1,
+    /// @brief Интервалы эскиза выборки p-value (uint64).
+    column_sketch = 2,
+    /// @brief Последняя смоделированная выборка (uint64).
+    column_sample = 3,
+    /// @brief Эмперические частоты последней выборки (uint64).
+    column_exp_freq = 4,
+    /// @brief Теоретические вероятности нулевой гипотезы (double).
+    column_th_freq = 5,
+    /// @brief Количество смоделированных p-value в контрольной точке (uint64).
+    column_replicate = 6,
+    /// @brief Состояние генератора случайных чисел в текстовом виде (uint8).
+    column_rng_state = 7,
+    /// @brief Диапазон номеров повторений [начало, конец) части результата (uint64).
+    column_range = 8
+};
+
+/// @brief Типы элементов столбцов.
+enum ResultColumnType
+{
+    /// @brief 64-битное число с плавающей точкой.
+    type_f64 = 1,
+    /// @brief 64-битное беззнаковое целое.
+    type_u64 = 2,
+    /// @brief Байт.
+    type_u8 = 3
+};
+
+/// @brief Флаги дополнительных столбцов при записи.
+enum ResultFlags
+{
+    /// @brief Записать последнюю смоделированную выборку.
+    result_sample = 1,
+    /// @brief Записать эмперические частоты и теоретические вероятности.
+    result_hist = 2
+};
+
+/// @brief Заголовок файла с результатами.
+struct ResultHeader
+{
+    /// @brief Сигнатура "NBRESULT".
+    char magic[8];
+    /// @brief Версия формата.
+    uint32_t version;
+    /// @brief Количество столбцов.
+    uint32_t num_columns;
+    /// @brief Вероятность успеха нулевой гипотезы.
+    double d0_p;
+    /// @brief Количество успехов нулевой гипотезы.
+    uint64_t d0_k;
+    /// @brief Вероятность успеха альтернативной гипотезы.
+    double d1_p;
+    /// @brief Количество успехов альтернативной гипотезы.
+    uint64_t d1_k;
+    /// @brief Размер выборки.
+    uint64_t n;
+    /// @brief Размер выборки p-value.
+    uint64_t num_p_value;
+    /// @brief Уровень значимости.
+    double sign_lv;
+    /// @brief Инициация генератора случайных чисел.
+    uint64_t seed;
+    /// @brief Гипотеза, на основе которой моделировалась выборка (0 или 1).
+    uint32_t hyp;
+    /// @brief Зарезервировано.
+    uint32_t reserved;
+    /// @brief Название метода моделирования.
+    char method[32];
+};
+
+/// @brief Описание столбца в каталоге.
+struct ResultColumnInfo
+{
+    /// @brief Идентификатор столбца (ResultColumnId).
+    uint32_t id;
+    /// @brief Тип элементов (ResultColumnType).
+    uint32_t type;
+    /// @brief Количество элементов.
+    uint64_t count;
+    /// @brief Смещение данных от начала файла.
+    uint64_t offset;
+};
+
+/// @brief Столбец для записи.
+struct ResultColumn
+{
+    /// @brief Идентификатор столбца (ResultColumnId).
+    uint32_t id;
+    /// @brief Тип элементов (ResultColumnType).
+    uint32_t type;
+    /// @brief Количество элементов.
+    uint64_t count;
+    /// @brief Указатель на данные.
+    const void* data;
+};
+
+/// @brief Записывает файл с результатами.
+/// @param[in] path Путь к файлу.
+/// @param[in] head Заголовок (поля magic, version и num_columns заполняются функцией).
+/// @param[in] num_columns Количество столбцов.
+/// @param[in] columns Столбцы.
+void write_result(const char* path, ResultHeader head, size_t num_columns, const ResultColumn* columns);
+
+/// @brief Класс чтения файла с результатами.
+/// @details Отображает файл в память и предоставляет доступ к заголовку и столбцам без копирования.
+/// Указатели на столбцы действительны, пока существует объект.
+class Result_NB
+{
+private:
+    /// @brief Отображённый в память файл.
+    const unsigned char* data;
+    /// @brief Размер файла.
+    size_t size;
+    /// @brief Дескриптор отображения.
+    void* handle;
+
+    /// @brief Осуществляет обмен полями между объектом класса и переданным r.
+    /// @param[in, out] r Объект класса Result_NB.
+    void swap(Result_NB& r);
+
+    /// @brief Снимает отображение файла.
+    void unmap();
+public:
+    /// @brief Открывает файл с результатами.
+    /// @param[in] path Путь к файлу.
+    Result_NB(const char* path);
+
+    Result_NB(const Result_NB& r) = delete;
+
+    /// @brief Конструктор перемещения.
+    /// @param[in] r Объект класса Result_NB.
+    Result_NB(Result_NB&& r);
+
+    Result_NB& operator=(const Result_NB& r) = delete;
+
+    /// @brief Доступ к заголовку.
+    /// @return Заголовок файла.
+    inline const ResultHeader& get_header() const { return *(const ResultHeader*)data; }
+
+    /// @brief Доступ к столбцу.
+    /// @param[in] id Идентификатор столбца.
+    /// @param[in] type Ожидаемый тип элементов.
+    /// @param[out] count Количество элементов.
+    /// @return Указатель на данные столбца или nullptr, если столбца нет.
+    const void* get_column(uint32_t id, uint32_t type, size_t& count) const;
+
+    /// @brief Доступ к выборке p-value.
+    /// @param[out] count Размер выборки p-value.
+    /// @return Указатель на отсортированную выборку p-value или nullptr.
+    inline const double* get_p_value(size_t& count) const { return (const double*)get_column(column_p_value, type_f64, count); }
+
+    /// @brief Доступ к эскизу выборки p-value.
+    /// @param[out] count Количество интервалов.
+    /// @return Указатель на интервалы эскиза или nullptr.
+    inline const uint64_t* get_sketch(size_t& count) const { return (const uint64_t*)get_column(column_sketch, type_u64, count); }
+
+    /// @brief Доступ к смоделированной выборке.
+    /// @param[out] count Размер выборки.
+    /// @return Указатель на выборку или nullptr.
+    inline const uint64_t* get_sample(size_t& count) const { return (const uint64_t*)get_column(column_sample, type_u64, count); }
+
+    /// @brief Доступ к эмперическим частотам.
+    /// @param[out] count Размер массива частот.
+    /// @return Указатель на частоты или nullptr.
+    inline const uint64_t* get_exp_freq(size_t& count) const { return (const uint64_t*)get_column(column_exp_freq, type_u64, count); }
+
+    /// @brief Доступ к теоретическим вероятностям.
+    /// @param[out] count Размер массива вероятностей.
+    /// @return Указатель на вероятности или nullptr.
+    inline const double* get_th_freq(size_t& count) const { return (const double*)get_column(column_th_freq, type_f64, count); }
+
+    /// @brief Деструктор Result_NB.
+    ~Result_NB();
+};
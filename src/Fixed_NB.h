@@ -0,0 +1,200 @@
+/// @file
+/// @brief Таблицы распределения для фиксированных гипотез, вычисляемые на этапе компиляции.
+/// @details Для гипотез из списка NB_FIXED_CONFIGS теоретические вероятности и таблица суммированных вероятностей
+/// вычисляются компилятором (constexpr) теми же операциями и в том же порядке, что NB_distr, Sample_Table::make_sum_distr
+/// и ChiSqHist::calc_th_freq, поэтому совпадают с ними до бита. Табличные методы и критерий \f$ \chi ^2 \f$ берут такие таблицы
+/// без вычислений при создании, а Sample_Table_Fixed ищет по ним с известным на этапе компиляции размером.
+/// Для остальных параметров таблицы по-прежнему вычисляются во время работы.
+#pragma once
+
+#include <cstddef>
+#include <utility>
+
+#ifndef NB_FIXED_CONFIGS
+/// @brief Список фиксированных гипотез в виде X(p, k).
+/// @details Может быть задан при сборке, например -D'NB_FIXED_CONFIGS(X)=X(0.8, 10) X(0.5, 3)'. Вероятность p^k
+/// должна быть не пренебрежимо мала по сравнению с 1 (окно распределения начинается с нуля), а количество значений - не больше max_fixed_states.
+#define NB_FIXED_CONFIGS(X) X(0.8, 10) X(0.5, 3) X(0.5, 10) X(0.3, 5)
+#endif
+
+/// @brief Наибольшее количество значений таблицы фиксированной гипотезы.
+const size_t max_fixed_states = 1024;
+
+/// @brief Параметры фиксированной гипотезы.
+struct FixedConfig
+{
+    /// @brief Вероятность успеха.
+    double p;
+    /// @brief Количество успехов.
+    size_t k;
+};
+
+#define NB_FIXED_CONFIG_ITEM(p, k) FixedConfig{p, k},
+
+/// @brief Фиксированные гипотезы.
+constexpr FixedConfig fixed_configs[] = { NB_FIXED_CONFIGS(NB_FIXED_CONFIG_ITEM) };
+
+#undef NB_FIXED_CONFIG_ITEM
+
+/// @brief Количество фиксированных гипотез.
+constexpr size_t num_fixed_configs = sizeof(fixed_configs) / sizeof(fixed_configs[0]);
+
+/// @brief Возведение в степень (те же умножения, что fast_deg).
+/// @param[in] x Основание.
+/// @param[in] alpha Показатель.
+/// @return Степень.
+constexpr double fixed_deg(double x, size_t alpha)
+{
+    double res = 1;
+
+    while (alpha != 0)
+    {
+        if (alpha & 1)
+            res *= x;
+
+        x *= x;
+        alpha >>= 1;
+    }
+
+    return res;
+}
+
+/// @brief Количество значений окна распределения, начинающегося с нуля (как в NB_distr::make_support).
+/// @param[in] p Вероятность успеха.
+/// @param[in] k Количество успехов.
+/// @return Количество значений или 0, если вероятность нуля пренебрежимо мала.
+constexpr size_t fixed_num_states(double p, size_t k)
+{
+    double q = 1 - p, prob = fixed_deg(p, k);
+    size_t m = k > 1 ? size_t((k - 1) * (1 - p) / p) : 0, num = 1;
+
+    if (1.0 + prob == 1.0)
+        return 0;
+
+    for (size_t x = 1; ; ++x)
+    {
+        prob = prob * (k + x - 1) * q / x;
+
+        if (x > m && 1.0 + prob == 1.0)
+            break;
+
+        ++num;
+    }
+
+    return num;
+}
+
+/// @brief Таблицы фиксированной гипотезы.
+/// @tparam N Количество значений.
+template <size_t N>
+struct FixedTable
+{
+    /// @brief Теоретические вероятности значений.
+    double prob[N];
+    /// @brief Суммированные вероятности.
+    double sum[N];
+};
+
+/// @brief Вычисляет таблицы фиксированной гипотезы.
+/// @tparam N Количество значений (fixed_num_states).
+/// @param[in] p Вероятность успеха.
+/// @param[in] k Количество успехов.
+/// @return Таблицы.
+template <size_t N>
+constexpr FixedTable<N> make_fixed_table(double p, size_t k)
+{
+    FixedTable<N> t{};
+
+    t.prob[0] = fixed_deg(p, k);
+    t.sum[0] = t.prob[0];
+
+    // Та же формула, что NB_distr::next_prob.
+    for (size_t i = 1; i < N; ++i)
+    {
+        t.prob[i] = t.prob[i - 1] * (k + i - 1) * (1 - p) / i;
+        t.sum[i] = t.sum[i - 1] + t.prob[i];
+    }
+
+    return t;
+}
+
+/// @brief Фиксированная гипотеза с номером I и её таблицы.
+/// @tparam I Номер гипотезы в fixed_configs.
+template <size_t I>
+struct FixedNB
+{
+    /// @brief Вероятность успеха.
+    static constexpr double p = fixed_configs[I].p;
+    /// @brief Количество успехов.
+    static constexpr size_t k = fixed_configs[I].k;
+    /// @brief Количество значений.
+    static constexpr size_t num = fixed_num_states(p, k);
+
+    static_assert(num > 0, "FixedNB: probability of zero is negligible, use the runtime tables.");
+    static_assert(num <= max_fixed_states, "FixedNB: too many states for a fixed table.");
+
+    /// @brief Таблицы.
+    static constexpr FixedTable<num> table = make_fixed_table<num>(p, k);
+};
+
+template <size_t I>
+constexpr double FixedNB<I>::p;
+
+template <size_t I>
+constexpr size_t FixedNB<I>::k;
+
+template <size_t I>
+constexpr size_t FixedNB<I>::num;
+
+template <size_t I>
+constexpr FixedTable<FixedNB<I>::num> FixedNB<I>::table;
+
+/// @brief Таблицы фиксированной гипотезы без параметра шаблона.
+struct FixedView
+{
+    /// @brief Вероятность успеха.
+    double p;
+    /// @brief Количество успехов.
+    size_t k;
+    /// @brief Количество значений.
+    size_t num;
+    /// @brief Теоретические вероятности значений.
+    const double* prob;
+    /// @brief Суммированные вероятности.
+    const double* sum;
+};
+
+/// @brief Таблицы всех фиксированных гипотез.
+/// @return Массив из num_fixed_configs элементов.
+template <size_t... I>
+inline const FixedView* fixed_views(std::index_sequence<I...>)
+{
+    static const FixedView views[] = { FixedView{FixedNB<I>::p, FixedNB<I>::k, FixedNB<I>::num, FixedNB<I>::table.prob, FixedNB<I>::table.sum}... };
+
+    return views;
+}
+
+/// @brief Номер фиксированной гипотезы.
+/// @param[in] p Вероятность успеха.
+/// @param[in] k Количество успехов.
+/// @return Номер в fixed_configs или num_fixed_configs, если гипотезы нет в списке.
+inline size_t fixed_index(double p, size_t k)
+{
+    size_t i = 0;
+
+    while (i < num_fixed_configs && (fixed_configs[i].p != p || fixed_configs[i].k != k))
+        ++i;
+
+    return i;
+}
+
+/// @brief Таблицы фиксированной гипотезы.
+/// @param[in] p Вероятность успеха.
+/// @param[in] k Количество успехов.
+/// @return Указатель на таблицы или nullptr, если гипотезы нет в списке.
+inline const FixedView* find_fixed(double p, size_t k)
+{
+    size_t i = fixed_index(p, k);
+
+    return i < num_fixed_configs ? fixed_views(std::make_index_sequence<num_fixed_configs>()) + i : nullptr;
+}
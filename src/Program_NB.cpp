@@ -1,6 +1,26 @@
+#include <thread>
 #include "Program_NB.h"
 
+void prewarm(Doc_NB doc)
+{
+    // Копия моделирует собственным генератором и не мешает окну, которое использует глобальный generator.
+    try
+    {
+        doc.make_p_value();
+    }
+    catch (const char* e)
+    {
+        std::cerr << e << "\n";
+    }
+}
+
 int program_NB::run()
 {
-    return painter.run();
+    // Пока открывается окно, выборка p-value для параметров по умолчанию моделируется в отдельном потоке и попадает в кэш.
+    std::thread warm(prewarm, data);
+    int res = painter.run();
+
+    warm.join();
+
+    return res;
 }
\ No newline at end of file
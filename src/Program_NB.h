@@ -10,7 +10,7 @@ private:
     Doc_NB data;
     Draw_NB painter;
 public:
-    program_NB() : data(), painter(&data) { }
+    program_NB(ResultCache* cache = nullptr) : data(), painter(&data) { data.set_cache(cache); }
 
     int run();
 };
\ No newline at end of file
@@ -0,0 +1,188 @@
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <thread>
+#include "Sweep_NB.h"
+
+/// Конфигурация (p1, k1, n) - единица работы потока.
+struct SweepTask
+{
+    size_t id;
+    double p1;
+    size_t k1;
+    size_t n;
+    double cost;
+};
+
+/// Метод моделирования альтернативы (p1, k1), который поток хранит между конфигурациями.
+struct SweepSampler
+{
+    NB_distr d1;
+    Sample* s;
+};
+
+Sweep_NB::Sweep_NB(NB_distr _d0, size_t _num_p_value) : d0(_d0), num_p_value(_num_p_value), table_method(true), num_threads(0)
+{
+
+}
+
+void Sweep_NB::set_grid(const std::vector<double>& _p1_arr, const std::vector<size_t>& _k1_arr,
+                        const std::vector<size_t>& _n_arr, const std::vector<double>& _sign_lv_arr)
+{
+    p1_arr = _p1_arr;
+    k1_arr = _k1_arr;
+    n_arr = _n_arr;
+    sign_lv_arr = _sign_lv_arr;
+}
+
+void Sweep_NB::set_table_method()
+{
+    table_method = true;
+}
+
+void Sweep_NB::set_bernulli_method()
+{
+    table_method = false;
+}
+
+void Sweep_NB::set_threads(size_t _num_threads)
+{
+    num_threads = _num_threads;
+}
+
+double Sweep_NB::cost(double p1, size_t k1, size_t n) const
+{
+    double mean = k1 * (1 - p1) / p1;
+
+    if (table_method)
+        return double(num_p_value) * (mean < sorted_min_mean ? n * (1 + mean) : n + mean);
+
+    return double(num_p_value) * n * k1 / p1;
+}
+
+void Sweep_NB::run(std::function<void(const SweepCell&)> on_cell)
+{
+    std::vector<SweepTask> tasks;
+
+    for (size_t i = 0; i < p1_arr.size(); ++i)
+        for (size_t j = 0; j < k1_arr.size(); ++j)
+            for (size_t l = 0; l < n_arr.size(); ++l)
+            {
+                SweepTask t = {tasks.size(), p1_arr[i], k1_arr[j], n_arr[l], cost(p1_arr[i], k1_arr[j], n_arr[l])};
+                tasks.push_back(t);
+            }
+
+    // Самые дорогие конфигурации - первыми, чтобы в конце потоки не ждали одну длинную конфигурацию.
+    std::stable_sort(tasks.begin(), tasks.end(), [](const SweepTask& a, const SweepTask& b) { return a.cost > b.cost; });
+
+    std::atomic<size_t> next(0);
+    std::mutex out_mutex;
+    std::exception_ptr error;
+
+    auto worker = [&]()
+    {
+        std::default_random_engine gen;
+        NB_distr h0 = d0;
+        std::map<std::pair<double, size_t>, SweepSampler*> samplers;
+        ChiSqHist* chisq = nullptr;
+        double* p_value_arr = nullptr;
+        double* chi_sq = nullptr;
+
+        // Исключение потока передаётся вызывающему потоку, иначе оно завершило бы программу.
+        try
+        {
+            ChiSqBatch<double> batch;
+
+            p_value_arr = new double[num_p_value];
+            chi_sq = new double[batch_reps];
+
+            for (size_t t = next++; t < tasks.size(); t = next++)
+            {
+                const SweepTask& task = tasks[t];
+                SweepSampler*& sampler = samplers[std::make_pair(task.p1, task.k1)];
+
+                if (!sampler)
+                {
+                    sampler = new SweepSampler{NB_distr(task.p1, task.k1), nullptr};
+
+                    if (table_method)
+                        sampler->s = make_sample_table(task.n, &sampler->d1);
+                    else
+                        sampler->s = new Sample_Bernulli(task.n, &sampler->d1);
+
+                    sampler->s->set_generator(&gen);
+                }
+                else
+                    sampler->s->change_param(task.n);
+
+                // Теоретические вероятности нулевой гипотезы считаются один раз, план объединения - при смене n.
+                if (!chisq)
+                    chisq = new ChiSqHist(&h0, sampler->s);
+                else
+                    chisq->set_sample(sampler->s);
+
+                gen.seed(replicate_seed(task.id) % 2147483647);
+
+                // Статистики повторений вычисляются пакетами по batch_reps.
+                chisq->update_plan();
+                batch.set_plan(*chisq);
+
+                for (size_t i = 0; i < num_p_value; ++i)
+                {
+                    chisq->simulate_exp_freq();
+                    batch.add(*chisq);
+
+                    if (batch.full() || i + 1 == num_p_value)
+                        batch.evaluate(chi_sq, p_value_arr + i + 1 - batch.size());
+                }
+
+                std::sort(p_value_arr, p_value_arr + num_p_value);
+
+                std::lock_guard<std::mutex> lock(out_mutex);
+
+                for (size_t i = 0; i < sign_lv_arr.size(); ++i)
+                {
+                    SweepCell cell = {task.p1, task.k1, task.n, sign_lv_arr[i], 0};
+                    cell.power = double(std::lower_bound(p_value_arr, p_value_arr + num_p_value, cell.sign_lv) - p_value_arr) / num_p_value;
+
+                    on_cell(cell);
+                }
+            }
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(out_mutex);
+
+            if (!error)
+                error = std::current_exception();
+
+            next = tasks.size();
+        }
+
+        for (auto it = samplers.begin(); it != samplers.end(); ++it)
+        {
+            delete it->second->s;
+            delete it->second;
+        }
+
+        delete chisq;
+        delete[] p_value_arr;
+        delete[] chi_sq;
+    };
+
+    size_t threads = num_threads ? num_threads : std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::thread> pool;
+
+    for (size_t i = 1; i < threads && i < tasks.size(); ++i)
+        pool.push_back(std::thread(worker));
+
+    worker();
+
+    for (size_t i = 0; i < pool.size(); ++i)
+        pool[i].join();
+
+    if (error)
+        std::rethrow_exception(error);
+}
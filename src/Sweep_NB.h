@@ -0,0 +1,93 @@
+/// @file
+/// @brief Вычисление мощности критерия на сетке параметров.
+/// @details Для фиксированной нулевой гипотезы вычисляет мощность критерия \f$ \chi ^2 \f$ для всех сочетаний
+/// параметров альтернативы (p1, k1), размеров выборки n и уровней значимости alpha. Конфигурации (p1, k1, n) распределяются
+/// между потоками по оценке их стоимости, результаты передаются по мере готовности каждой ячейки.
+#pragma once
+
+#include <functional>
+#include <vector>
+#include "Doc_NB.h"
+
+/// @brief Ячейка сетки параметров.
+struct SweepCell
+{
+    /// @brief Вероятность успеха альтернативы.
+    double p1;
+    /// @brief Количество успехов альтернативы.
+    size_t k1;
+    /// @brief Размер выборки.
+    size_t n;
+    /// @brief Уровень значимости.
+    double sign_lv;
+    /// @brief Мощность критерия (доля p-value, меньших уровня значимости).
+    double power;
+};
+
+/// @brief Класс вычисления мощности на сетке параметров.
+/// @details Ячейки с одинаковыми (p1, k1, n) используют одну выборку p-value, поэтому уровни значимости почти ничего не стоят.
+/// Каждый поток хранит таблицы методов моделирования для уже встречавшихся (p1, k1) и теоретические вероятности
+/// нулевой гипотезы с планом объединения состояний. Конфигурация с номером i моделируется генератором, инициированным
+/// replicate_seed(i), поэтому результат не зависит от количества потоков и порядка вычислений. Статистики \f$ \chi ^2 \f$
+/// повторений вычисляются пакетами (ChiSqBatch).
+class Sweep_NB
+{
+private:
+    /// @brief Распределение нулевой гипотезы.
+    NB_distr d0;
+    /// @brief Размер выборки p-value в каждой конфигурации.
+    size_t num_p_value;
+    /// @brief Используется ли табличный метод (иначе - метод Бернулли).
+    bool table_method;
+    /// @brief Количество потоков.
+    size_t num_threads;
+
+    /// @brief Вероятности успеха альтернативы.
+    std::vector<double> p1_arr;
+    /// @brief Количества успехов альтернативы.
+    std::vector<size_t> k1_arr;
+    /// @brief Размеры выборки.
+    std::vector<size_t> n_arr;
+    /// @brief Уровни значимости.
+    std::vector<double> sign_lv_arr;
+public:
+    /// @brief Конструктор по нулевой гипотезе и размеру выборки p-value.
+    /// @param[in] _d0 Распределение нулевой гипотезы.
+    /// @param[in] _num_p_value Размер выборки p-value в каждой конфигурации.
+    Sweep_NB(NB_distr _d0 = NB_distr(), size_t _num_p_value = 10000);
+
+    /// @brief Задание сетки параметров.
+    /// @param[in] _p1_arr Вероятности успеха альтернативы.
+    /// @param[in] _k1_arr Количества успехов альтернативы.
+    /// @param[in] _n_arr Размеры выборки.
+    /// @param[in] _sign_lv_arr Уровни значимости.
+    void set_grid(const std::vector<double>& _p1_arr, const std::vector<size_t>& _k1_arr,
+                  const std::vector<size_t>& _n_arr, const std::vector<double>& _sign_lv_arr);
+
+    /// @brief Установка в качестве метода моделирования табличного метода.
+    void set_table_method();
+    /// @brief Установка в качестве метода моделирования метода Бернулли.
+    void set_bernulli_method();
+
+    /// @brief Изменение количества потоков.
+    /// @param[in] _num_threads Количество потоков (0 - по количеству ядер).
+    void set_threads(size_t _num_threads);
+
+    /// @brief Доступ к количеству ячеек сетки.
+    /// @return Количество ячеек.
+    inline size_t get_num_cells() const { return p1_arr.size() * k1_arr.size() * n_arr.size() * sign_lv_arr.size(); }
+
+    /// @brief Оценка стоимости моделирования конфигурации в условных единицах (количество обращений к генератору и таблице).
+    /// @details Метод Бернулли тратит около k/p испытаний на значение. Табличный метод тратит около 1 + k(1 - p)/p шагов поиска
+    /// на значение или, если частоты получаются проходом по упорядоченным числам, около n + k(1 - p)/p шагов на выборку.
+    /// @param[in] p1 Вероятность успеха альтернативы.
+    /// @param[in] k1 Количество успехов альтернативы.
+    /// @param[in] n Размер выборки.
+    /// @return Оценка стоимости.
+    double cost(double p1, size_t k1, size_t n) const;
+
+    /// @brief Вычисление мощности во всех ячейках сетки.
+    /// @details on_cell вызывается для каждой ячейки сразу после её вычисления, по одной за раз, из рабочих потоков.
+    /// @param[in] on_cell Функция, получающая вычисленную ячейку.
+    void run(std::function<void(const SweepCell&)> on_cell);
+};
@@ -0,0 +1,62 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include "../Doc_NB.h"
+
+// Сравнение подсчёта частот по вспомогательным гистограммам (add_freq) с подсчётом по одному значению (add_freq_serial).
+//
+// histogram [n] [reps]
+//
+// Для каждой конфигурации моделирует выборку табличным методом, выводит время подсчёта её частот обоими способами
+// и ускорение, а также проверяет, что частоты совпадают.
+
+template <class T, class F>
+double time_count(const std::vector<T>& values, size_t num, size_t reps, std::vector<size_t>& freq, F count)
+{
+    SampleView<T> v{values.data(), values.size()};
+
+    freq.assign(num, 0);
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < reps; ++i)
+        count(v, freq.data(), num, 0);
+
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / reps;
+}
+
+int main(int argc, char** argv)
+{
+    size_t n = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1000000;
+    size_t reps = argc > 2 ? strtoull(argv[2], nullptr, 10) : 100;
+    std::default_random_engine g(1);
+
+    const NB_distr conf[] = {NB_distr(0.95, 1), NB_distr(0.8, 10), NB_distr(0.5, 5), NB_distr(0.5, 20), NB_distr(0.05, 10)};
+
+    std::cout << std::left << std::setw(14) << "p, k" << std::setw(10) << "states"
+              << std::setw(14) << "serial, us" << std::setw(14) << "lanes, us" << std::setw(10) << "speedup" << "same\n";
+
+    for (NB_distr d : conf)
+    {
+        Sample_Table s(n, &d);
+        std::vector<uint8_t> values(n);
+        std::vector<size_t> serial, lanes;
+        size_t num = d.get_num_states();
+
+        s.set_generator(&g);
+        s.simulate();
+
+        for (size_t i = 0; i < n; ++i)
+            values[i] = uint8_t(std::min<size_t>(s[int(i)], 255));
+
+        double t0 = time_count(values, num, reps, serial, add_freq_serial<uint8_t>);
+        double t1 = time_count(values, num, reps, lanes, add_freq<uint8_t>);
+
+        std::cout << std::left << std::setw(14) << (std::to_string(d.get_p()).substr(0, 4) + ", " + std::to_string(d.get_k()))
+                  << std::setw(10) << num << std::setw(14) << t0 << std::setw(14) << t1 << std::setw(10) << t0 / t1
+                  << (serial == lanes ? "yes" : "NO") << "\n";
+    }
+
+    return 0;
+}
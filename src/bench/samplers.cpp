@@ -0,0 +1,99 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include "../Doc_NB.h"
+
+// Сравнение общего табличного метода со специализированным (make_sample_table)
+// и табличного метода по целым числам генератора (Sample_Table_Int) с табличным методом
+// и побитового метода Бернулли (Sample_Bernulli_Bits) с методом Бернулли, а также подсчёта частот
+// после моделирования выборки с получением частот сразу (Sample::simulate_freq).
+//
+// samplers [n] [reps]
+//
+// Для каждой конфигурации выводит время моделирования одной выборки обоими методами и ускорение,
+// а также проверяет, что при одинаковой инициации генератора выборки совпадают (кроме побитового метода Бернулли
+// и частот, для которых генератор используется иначе).
+
+double time_sample(Sample* s, size_t reps, std::default_random_engine& g)
+{
+    g.seed(1);
+    s->set_generator(&g);
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < reps; ++i)
+        s->simulate();
+
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / reps;
+}
+
+double time_freq(Sample* s, size_t num, size_t reps, std::default_random_engine& g, bool direct)
+{
+    size_t* freq = new size_t[num]{};
+
+    g.seed(1);
+    s->set_generator(&g);
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < reps; ++i)
+    {
+        if (direct)
+            s->simulate_freq(freq, num);
+        else
+        {
+            s->simulate();
+            s->count_freq(freq, num);
+        }
+    }
+
+    double res = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / reps;
+
+    delete[] freq;
+
+    return res;
+}
+
+bool same_sample(const Sample* a, const Sample* b)
+{
+    for (size_t i = 0; i < a->get_n(); ++i)
+        if ((*a)[i] != (*b)[i])
+            return false;
+
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    size_t n = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1000;
+    size_t reps = argc > 2 ? strtoull(argv[2], nullptr, 10) : 1000;
+    std::default_random_engine g;
+
+    const NB_distr conf[] = {NB_distr(0.8, 10), NB_distr(0.84, 11), NB_distr(0.5, 5), NB_distr(0.5, 20), NB_distr(0.9, 50),
+                             NB_distr(0.05, 10), NB_distr(0.02, 3)};
+
+    std::cout << std::left << std::setw(21) << "Method" << std::setw(14) << "p, k"
+              << std::setw(14) << "generic, us" << std::setw(14) << "fixed, us" << std::setw(10) << "speedup" << "same\n";
+
+    for (NB_distr d : conf)
+        for (int method = 1; method < 5; ++method)
+        {
+            Sample* generic = method == 4 ? make_sample_table(n, &d) : method % 3 ? (Sample*)new Sample_Table(n, &d)
+                            : (Sample*)new Sample_Bernulli(n, &d);
+            Sample* fixed = method == 4 ? make_sample_table(n, &d) : method == 3 ? new Sample_Bernulli_Bits(n, &d)
+                          : method == 2 ? new Sample_Table_Int(n, &d) : make_sample_table(n, &d);
+
+            double t0 = method == 4 ? time_freq(generic, Sample_Table::max_num(&d), reps, g, false) : time_sample(generic, reps, g);
+            double t1 = method == 4 ? time_freq(fixed, Sample_Table::max_num(&d), reps, g, true) : time_sample(fixed, reps, g);
+
+            std::cout << std::left << std::setw(21) << (method == 4 ? "Table Method, freq" : fixed->get_name())
+                      << std::setw(14) << (std::to_string(d.get_p()).substr(0, 4) + ", " + std::to_string(d.get_k()))
+                      << std::setw(14) << t0 << std::setw(14) << t1 << std::setw(10) << t0 / t1
+                      << (method >= 3 ? "-" : same_sample(generic, fixed) ? "yes" : "NO") << "\n";
+
+            delete generic;
+            delete fixed;
+        }
+
+    return 0;
+}
@@ -89,6 +89,12 @@ int main(int argc, char** argv){
     
     std::cout << "\n";
 
+    // Моделирование одной большой выборки в нескольких потоках (частоты не зависят от количества потоков).
+    chi_sq->simulate_exp_freq_parallel(1000000);
+    chi_sq->calc_chi_sq();
+
+    std::cout << "P-value выборки размера " << chi_sq->get_freq_n() << ": " << chi_sq->get_p_value() << "\n";
+
     std::cout << "Выборка p-value: ";
 
     // Вывод выборки p-value.
@@ -97,6 +103,9 @@ int main(int argc, char** argv){
 
     std::cout << "\n";
 
+    // Аналитическая мощность критерия (нецентральное распределение хи квадрат) и её сравнение с моделированием.
+    std::cout << "Мощность при n = 200: " << doc.analytic_power(200) << ", отклонение от моделирования: " << doc.check_power(200) << "\n";
+
     // Установка в качестве распределения нулевой гипотезы.
     doc.set_hyp_d0();
     // Установка в качестве метода моделирования табличного метода.
@@ -1,12 +1,21 @@
 #include <iostream>
+#include <cstdlib>
+#include "Cache_NB.h"
 #include "Program_NB.h"
 
 int main(int argn, char **argv)
 {
-    seed = std::chrono::system_clock::now().time_since_epoch().count();
+    // Постоянный seed, чтобы эксперименты повторялись между запусками и читались из кэша (NB_SEED задаёт другой).
+    const char* env_seed = getenv("NB_SEED");
+    const char* env_cache = getenv("NB_CACHE_DIR");
+
+    seed = env_seed ? strtoul(env_seed, nullptr, 10) : 1;
     generator = std::default_random_engine(seed);
+    // Короткое измерение методов моделирования для автоматического выбора метода.
+    sample_cost.calibrate();
 
-    program_NB p;
+    ResultCache cache(env_cache ? env_cache : "nb_cache");
+    program_NB p(&cache);
 
     return p.run();
 }
\ No newline at end of file
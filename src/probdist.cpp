@@ -6,6 +6,7 @@
 #include "probdist.h"
 
 const double Eps = 1e-15;
+const double Pi = 3.14159265358979323846;
 
 int fequal( double a, double b )
 {
@@ -217,6 +218,48 @@ double pChi(double x, int n)
 	return 1.0-prob;
 }
 
+void pChiBatch(const double* x, int num, int n, double* res)
+{
+/*	' Chi-squared distribution function for num values with the same degrees of freedom:
+	'  res[j] = pChi(x[j], n).
+	' The set-up that depends only on n is done once; the arithmetic is that of CHI.
+*/
+	double X1, X3, QF, PROB, N = n, XN = 2.0 / (9.0 * N), SXN = sqrt(XN);
+	int i, j, QPIndex = 2 - n + 2 * (n / 2);
+
+	for( j = 0; j < num; ++j ) {
+		if ( fequal(x[j],0.0) ) {
+			res[j] = 0.0;
+			continue;
+		}
+
+		if( N > 40 ) {
+			X1 = (pow( x[j]/N, 0.3333333333) - 1.0 + XN ) / SXN;
+			NORMAL(1, X1, PROB);
+			res[j] = 1.0 - PROB;
+			continue;
+		}
+
+		X3 = sqrt(x[j]);
+
+		if( QPIndex != 1) {
+			PROB = exp(-x[j] / 2);
+			QF = PROB / 2;
+		}
+		else {
+			NORMAL(1, X3, PROB);
+			PROB = 2.0 * PROB;
+			QF = 0.3989422804 * exp(-x[j] / 2.0) / X3;
+		}
+
+		for( i= QPIndex; i < n;  i += 2 ) {
+			QF = QF * x[j] / i;
+			PROB = PROB + 2.0 * QF;
+		}
+		res[j] = 1.0 - PROB;
+	}
+}
+
 double xChi(double prob, int n)
 {
 	double x, p=1.0-prob;
@@ -224,3 +267,118 @@ double xChi(double prob, int n)
 	return x;
 }
 
+//
+//  Noncentral Chi-2 distribution
+//
+
+double pNonCentralChi(double x, int n, double lambda)
+{
+/*	' Noncentral chi-squared distribution function
+
+	' Poisson mixture of central distributions:
+	'  P(x) = sum_j exp(-L/2) (L/2)^j / j! * Chi(x, n + 2j)
+	' The sum is taken over +-10 standard deviations of the Poisson weights.
+*/
+	double h, w, res = 0.0;
+	int j, j0, j1;
+
+	if( lambda <= 0.0 )
+		return pChi(x, n);
+
+	h = lambda / 2.0;
+	j0 = (int)(h - 10.0 * sqrt(h)) - 10;
+	j1 = (int)(h + 10.0 * sqrt(h)) + 10;
+
+	if( j0 < 0 )
+		j0 = 0;
+
+	for( j = j0; j <= j1; ++j ) {
+		w = exp(-h + j * log(h) - lgamma(j + 1.0));
+		res += w * pChi(x, n + 2 * j);
+	}
+	return res;
+}
+
+//
+//  Kolmogorov distribution
+//
+
+double pKolmogorov(double x)
+{
+/*	' Limiting distribution of sqrt(n) * D_n:
+	'  K(x) = 1 - 2 sum_{j>=1} (-1)^(j-1) exp(-2 j^2 x^2)            for x >= 1,
+	'  K(x) = sqrt(2 pi) / x * sum_{j>=1} exp(-(2j-1)^2 pi^2 / (8 x^2))  for x < 1.
+*/
+	double res = 0.0, t;
+	int j;
+
+	if( x <= 0.0 )
+		return 0.0;
+
+	if( x < 1.0 ) {
+		for( j = 1; j <= 20; ++j ) {
+			t = exp(-(2 * j - 1) * (2 * j - 1) * Pi * Pi / (8.0 * x * x));
+			res += t;
+			if( t < Eps * res )
+				break;
+		}
+		return sqrt(2.0 * Pi) / x * res;
+	}
+
+	for( j = 1; j <= 100; ++j ) {
+		t = exp(-2.0 * j * j * x * x);
+		res += (j % 2 ? t : -t);
+		if( t < Eps )
+			break;
+	}
+	return 1.0 - 2.0 * res;
+}
+
+//
+//  Cramer-von Mises distribution
+//
+
+static double BesselK(double nu, double z)
+{
+/*	' Modified Bessel function of the second kind:
+	'  K_nu(z) = int_0^inf exp(-z cosh t) cosh(nu t) dt.
+	' The integrand decays double exponentially, so the trapezoidal rule converges quickly.
+*/
+	double h = 0.25, res = 0.5 * exp(-z), t, f;
+
+	for( t = h; ; t += h ) {
+		f = exp(-z * cosh(t)) * cosh(nu * t);
+		res += f;
+		if( f < Eps * res )
+			break;
+	}
+	return res * h;
+}
+
+double pCvM(double x)
+{
+/*	' Limiting distribution of the Cramer-von Mises statistic W^2 (Anderson, Darling, 1952):
+	'  P(x) = 1 / (pi sqrt(x)) sum_{j>=0} Gamma(j + 1/2) / (Gamma(1/2) j!) sqrt(4j + 1)
+	'         exp(-(4j + 1)^2 / (16 x)) K_{1/4}((4j + 1)^2 / (16 x)).
+	' Beyond x = 4 the upper tail is below 1e-8.
+*/
+	double res = 0.0, c = 1.0, u, t;
+	int j;
+
+	if( x <= 0.0 )
+		return 0.0;
+
+	if( x >= 4.0 )
+		return 1.0;
+
+	for( j = 0; j <= 100; ++j ) {
+		u = (4.0 * j + 1) * (4.0 * j + 1) / (16.0 * x);
+		t = c * sqrt(4.0 * j + 1) * exp(-u) * BesselK(0.25, u);
+		res += t;
+		if( t < Eps * res )
+			break;
+		c *= (j + 0.5) / (j + 1);
+	}
+	res /= Pi * sqrt(x);
+	return res < 1.0 ? res : 1.0;
+}
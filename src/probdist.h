@@ -4,4 +4,8 @@ double pNormal(double x);
 double xNormal(double prob);
 void  CHI( int type, double n, double &x, double &p);
 double pChi(double x, int n);
+void pChiBatch(const double* x, int num, int n, double* res);
 double xChi(double prob, int n);
+double pNonCentralChi(double x, int n, double lambda);
+double pKolmogorov(double x);
+double pCvM(double x);
@@ -0,0 +1,123 @@
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include "../Doc_NB.h"
+#include "../File_NB.h"
+
+// Моделирование частей выборки p-value в отдельных процессах и их объединение.
+//
+// shard run <d0_p> <d0_k> <d1_p> <d1_k> <n> <sign_lv> <bernulli|table|int|bits> <hyp 0|1> <seed> <begin> <end> <out> [sketch]
+//     моделирует повторения [begin, end) и записывает часть результата в out;
+// shard merge <out> <shard>...
+//     объединяет части в файл результата out и выводит мощность при уровне значимости частей.
+
+int usage()
+{
+    std::cerr << "Usage:\n"
+              << "  shard run <d0_p> <d0_k> <d1_p> <d1_k> <n> <sign_lv> <bernulli|table|int|bits> <hyp 0|1> <seed> <begin> <end> <out> [sketch]\n"
+              << "  shard merge <out> <shard>...\n";
+
+    return 1;
+}
+
+void set_method(Doc_NB& doc, const char* method)
+{
+    if (strcmp(method, "table") == 0 || strcmp(method, "Table Method") == 0)
+        doc.set_table_method();
+    else if (strcmp(method, "bernulli") == 0 || strcmp(method, "Bernulli Method") == 0)
+        doc.set_bernulli_method();
+    else if (strcmp(method, "int") == 0 || strcmp(method, "Integer Table Method") == 0)
+        doc.set_int_table_method();
+    else if (strcmp(method, "bits") == 0 || strcmp(method, "Bit Bernulli Method") == 0)
+        doc.set_bit_bernulli_method();
+    else
+        throw "shard: Unknown method.";
+}
+
+int run(int argc, char** argv)
+{
+    if (argc < 14)
+        return usage();
+
+    Doc_NB doc;
+    size_t begin = strtoull(argv[11], nullptr, 10), end = strtoull(argv[12], nullptr, 10);
+
+    seed = strtoul(argv[10], nullptr, 10);
+
+    if (argc > 14 && strcmp(argv[14], "sketch") == 0)
+        doc.set_sketch_storage();
+
+    doc.change_param(NB_distr(atof(argv[2]), atoi(argv[3])), NB_distr(atof(argv[4]), atoi(argv[5])), 1, atoi(argv[6]), atof(argv[7]));
+
+    if (atoi(argv[9]) == 1)
+        doc.set_hyp_d1();
+    else
+        doc.set_hyp_d0();
+
+    set_method(doc, argv[8]);
+
+    doc.make_p_value_range(begin, end);
+    doc.save_shard(argv[13]);
+
+    return 0;
+}
+
+int merge(int argc, char** argv)
+{
+    if (argc < 4)
+        return usage();
+
+    Doc_NB doc;
+    size_t count;
+    bool sketch;
+    ResultHeader head;
+
+    {
+        Result_NB first(argv[3]);
+
+        head = first.get_header();
+        sketch = first.get_sketch(count) != nullptr;
+    }
+
+    seed = head.seed;
+
+    if (sketch)
+        doc.set_sketch_storage(count);
+
+    doc.change_param(NB_distr(head.d0_p, head.d0_k), NB_distr(head.d1_p, head.d1_k), 1, head.n, head.sign_lv);
+
+    if (head.hyp == 1)
+        doc.set_hyp_d1();
+    else
+        doc.set_hyp_d0();
+
+    set_method(doc, head.method);
+
+    doc.merge_shards(argc - 3, argv + 3);
+    doc.save_result(argv[2]);
+
+    std::cout << "Number of p-value: " << doc.get_num_p_value() << "\n";
+    std::cout << "Power at significance level " << doc.get_sign_lv() << ": " << doc.p_value_ecdf(doc.get_sign_lv()) << "\n";
+
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        if (argc > 1 && strcmp(argv[1], "run") == 0)
+            return run(argc, argv);
+
+        if (argc > 1 && strcmp(argv[1], "merge") == 0)
+            return merge(argc, argv);
+    }
+    catch (const char* e)
+    {
+        std::cerr << e << "\n";
+
+        return 2;
+    }
+
+    return usage();
+}
@@ -0,0 +1,106 @@
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "../Sweep_NB.h"
+
+// Мощность критерия на сетке параметров альтернативы.
+//
+// sweep <d0_p> <d0_k> --p1 <list> --k1 <list> --n <list> --alpha <list>
+//       [--reps <num>] [--method table|bernulli] [--threads <num>] [--seed <num>]
+//
+// Списки задаются через запятую. Ячейки выводятся в формате CSV по мере вычисления.
+
+int usage()
+{
+    std::cerr << "Usage: sweep <d0_p> <d0_k> --p1 <list> --k1 <list> --n <list> --alpha <list>\n"
+              << "             [--reps <num>] [--method table|bernulli] [--threads <num>] [--seed <num>]\n";
+
+    return 1;
+}
+
+template <class T>
+std::vector<T> parse_list(const char* s)
+{
+    std::vector<T> res;
+    std::string str(s);
+    size_t pos = 0;
+
+    while (pos <= str.size())
+    {
+        size_t end = str.find(',', pos);
+
+        if (end == std::string::npos)
+            end = str.size();
+
+        res.push_back(T(atof(str.substr(pos, end - pos).c_str())));
+        pos = end + 1;
+    }
+
+    return res;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+        return usage();
+
+    std::vector<double> p1_arr, sign_lv_arr;
+    std::vector<size_t> k1_arr, n_arr;
+    size_t reps = 10000, threads = 0;
+    bool table = true;
+
+    for (int i = 3; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "--p1") == 0)
+            p1_arr = parse_list<double>(argv[i + 1]);
+        else if (strcmp(argv[i], "--k1") == 0)
+            k1_arr = parse_list<size_t>(argv[i + 1]);
+        else if (strcmp(argv[i], "--n") == 0)
+            n_arr = parse_list<size_t>(argv[i + 1]);
+        else if (strcmp(argv[i], "--alpha") == 0)
+            sign_lv_arr = parse_list<double>(argv[i + 1]);
+        else if (strcmp(argv[i], "--reps") == 0)
+            reps = strtoull(argv[i + 1], nullptr, 10);
+        else if (strcmp(argv[i], "--method") == 0)
+            table = strcmp(argv[i + 1], "bernulli") != 0;
+        else if (strcmp(argv[i], "--threads") == 0)
+            threads = strtoull(argv[i + 1], nullptr, 10);
+        else if (strcmp(argv[i], "--seed") == 0)
+            seed = strtoul(argv[i + 1], nullptr, 10);
+        else
+            return usage();
+    }
+
+    if (p1_arr.empty() || k1_arr.empty() || n_arr.empty() || sign_lv_arr.empty())
+        return usage();
+
+    Sweep_NB sweep(NB_distr(atof(argv[1]), atoi(argv[2])), reps);
+
+    sweep.set_grid(p1_arr, k1_arr, n_arr, sign_lv_arr);
+    sweep.set_threads(threads);
+
+    if (table)
+        sweep.set_table_method();
+    else
+        sweep.set_bernulli_method();
+
+    std::cout << "p1,k1,n,alpha,power\n";
+
+    try
+    {
+        sweep.run([](const SweepCell& c)
+        {
+            std::cout << c.p1 << "," << c.k1 << "," << c.n << "," << c.sign_lv << "," << c.power << std::endl;
+        });
+    }
+    catch (const char* e)
+    {
+        std::cerr << e << "\n";
+
+        return 2;
+    }
+
+    return 0;
+}